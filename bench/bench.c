@@ -0,0 +1,228 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#define HAVE_TSC
+#endif
+
+#include "sha256.h"
+#include "sha256_mb.h"
+
+/*
+ * Benchmarks for the kernels and the short message path.
+ *
+ *   1. sha256_short against sha256_init, sha256_update and sha256_final for
+ *      every length it takes, as the median and 99th percentile of the time
+ *      per message. Every digest feeds into the next message, so this is
+ *      latency rather than throughput.
+ *   2. Throughput of each single-buffer kernel on one long message, in MB/s
+ *      and in cycles per byte. Cycles are read off the time stamp counter,
+ *      which ticks at the base clock rather than the actual one.
+ *   3. Throughput of each multi-buffer kernel on batches of 4 KiB messages.
+ *
+ * Kernels the cpu can't run are skipped.
+ */
+
+#define SAMPLES		1001
+#define SAMPLE_REPS	256
+#define LONG_LEN	( ( size_t ) 1 << 20 )
+#define LONG_RUNS	7
+#define BATCH		256
+
+static const char *kernels[] = { "shani", "avx2", "ssse3", "scalar-bmi2", "scalar" };
+static const char *mb_kernels[] = { "avx512", "shani-x2", "avx2", "serial" };
+
+static double now( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t ticks( void )
+{
+#if defined( HAVE_TSC )
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static int cmp_double( const void *a, const void *b )
+{
+	double x = *( const double * ) a, y = *( const double * ) b;
+
+	return ( x > y ) - ( x < y );
+}
+
+static uint8_t *generic( const uint8_t *data, size_t len, uint8_t *md )
+{
+	struct sha256_ctx ctx;
+
+	sha256_init( &ctx );
+	sha256_update( &ctx, data, len );
+	sha256_final( &ctx, md );
+
+	return md;
+}
+
+/**
+ * time_short - time one way of hashing short messages
+ * @fn: hash function
+ * @len: message length
+ * @p50: output, median nanoseconds per message
+ * @p99: output, 99th percentile nanoseconds per message
+ */
+
+static void time_short( uint8_t *( *fn )( const uint8_t *, size_t, uint8_t * ), size_t len, double *p50, double *p99 )
+{
+	static double sample[ SAMPLES ];
+	uint8_t buf[ SHA256_DIGEST_SIZE + SHA256_SHORT_MAX ] = { 0 };
+
+	for ( size_t s = 0; s < SAMPLES; s++ )
+	{
+		double t = now();
+
+		for ( size_t r = 0; r < SAMPLE_REPS; r++ )
+			fn( buf, len, buf );
+
+		sample[ s ] = ( now() - t ) * 1e9 / SAMPLE_REPS;
+	}
+
+	qsort( sample, SAMPLES, sizeof( sample[ 0 ] ), cmp_double );
+	*p50 = sample[ SAMPLES / 2 ];
+	*p99 = sample[ SAMPLES * 99 / 100 ];
+}
+
+static void bench_short( void )
+{
+	printf( "short messages, ns per message\n" );
+	printf( "  len   short p50  short p99  generic p50  generic p99\n" );
+
+	for ( size_t len = 0; len <= SHA256_SHORT_MAX; len++ )
+	{
+		double s50, s99, g50, g99;
+
+		time_short( sha256_short, len, &s50, &s99 );
+		time_short( generic, len, &g50, &g99 );
+		printf( "  %3zu  %10.1f %10.1f  %11.1f  %11.1f\n", len, s50, s99, g50, g99 );
+	}
+}
+
+static void bench_kernels( const uint8_t *data )
+{
+	uint8_t md[ SHA256_DIGEST_SIZE ];
+
+	printf( "\nsingle-buffer kernels, %zu byte message\n", LONG_LEN );
+	printf( "  kernel          MB/s  cycles/byte\n" );
+
+	for ( size_t i = 0; i < sizeof( kernels ) / sizeof( kernels[ 0 ] ); i++ )
+	{
+		double best = 1e9;
+		uint64_t best_ticks = UINT64_MAX;
+
+		if ( sha256_set_kernel( kernels[ i ] ) != 0 )
+		{
+			printf( "  %-12s  skipped\n", kernels[ i ] );
+			continue;
+		}
+
+		for ( int r = 0; r < LONG_RUNS; r++ )
+		{
+			double t = now();
+			uint64_t c = ticks();
+
+			sha256( data, LONG_LEN, md );
+
+			c = ticks() - c;
+			t = now() - t;
+
+			if ( t < best )
+				best = t;
+
+			if ( c < best_ticks )
+				best_ticks = c;
+		}
+
+		printf( "  %-12s %6.0f  %11.2f\n", kernels[ i ], LONG_LEN / best / 1e6, ( double ) best_ticks / LONG_LEN );
+	}
+
+	sha256_set_kernel( NULL );
+}
+
+static void bench_mb( const uint8_t *data )
+{
+	static uint8_t md[ BATCH * SHA256_DIGEST_SIZE ];
+	const uint8_t *ptr[ BATCH ];
+
+	for ( size_t i = 0; i < BATCH; i++ )
+		ptr[ i ] = &data[ i * 4096 ];
+
+	sha256_set_avx512_min_batch( 0 );
+
+	printf( "\nmulti-buffer kernels, batches of %d messages of 4096 bytes\n", BATCH );
+	printf( "  kernel          MB/s  cycles/byte\n" );
+
+	for ( size_t i = 0; i < sizeof( mb_kernels ) / sizeof( mb_kernels[ 0 ] ); i++ )
+	{
+		double best = 1e9;
+		uint64_t best_ticks = UINT64_MAX;
+
+		if ( sha256_set_mb_kernel( mb_kernels[ i ] ) != 0 )
+		{
+			printf( "  %-12s  skipped\n", mb_kernels[ i ] );
+			continue;
+		}
+
+		for ( int r = 0; r < LONG_RUNS; r++ )
+		{
+			double t = now();
+			uint64_t c = ticks();
+
+			sha256_batch_4096( ptr, md, BATCH );
+
+			c = ticks() - c;
+			t = now() - t;
+
+			if ( t < best )
+				best = t;
+
+			if ( c < best_ticks )
+				best_ticks = c;
+		}
+
+		printf( "  %-12s %6.0f  %11.2f\n", mb_kernels[ i ], BATCH * 4096 / best / 1e6, ( double ) best_ticks / ( BATCH * 4096 ) );
+	}
+
+	sha256_set_mb_kernel( NULL );
+}
+
+int main( void )
+{
+	uint8_t *data = malloc( LONG_LEN );
+
+	if ( data == NULL )
+	{
+		perror( "malloc" );
+		return EXIT_FAILURE;
+	}
+
+	for ( size_t i = 0; i < LONG_LEN; i++ )
+		data[ i ] = ( uint8_t ) ( i * 131 + ( i >> 8 ) );
+
+	bench_short();
+	bench_kernels( data );
+	bench_mb( data );
+
+	free( data );
+
+	return EXIT_SUCCESS;
+}
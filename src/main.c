@@ -1,289 +1,967 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include "sha256.h"
+#include "sha256_file.h"
+#include "sha256_pool.h"
+#include "sha256_uring.h"
 
 /*
- * sha256 implimentation in c
+ * sha256sum compatible command line tool.
+ *
+ * Files are hashed as tasks on a thread pool, but the results still have to
+ * come out in argument order. Every file gets a slot in a ring of jobs, the
+ * reorder window. Once the ring is full the oldest job is waited for and
+ * reported before its slot takes the next file, so at most a window's worth
+ * of files is ever in flight and the output never gets ahead of the oldest
+ * unfinished file.
+ *
+ * Standard input is the exception. All the "-" arguments read the same
+ * stream, so they are hashed one after the other on the main thread, in
+ * argument order, when they are added.
+ *
+ * With --io=uring files go to the pool in batches instead, one task per batch,
+ * so that a single ring reads several files at once. Only the first job of a
+ * batch carries the task. The others are always behind it in the ring, so by
+ * the time one of them is the oldest its batch is known to be done.
  */
 
+struct job
+{
+	struct sha256_task task;
+	struct sha256_group group;
+	const char *name;
+	char *owned;
+	struct job *batch_next;
+	int follower;
+	int err;
+	uint8_t md[ SHA256_DIGEST_SIZE ];
+	uint8_t expect[ SHA256_DIGEST_SIZE ];
+};
+
+struct queue
+{
+	struct sha256_pool *pool;
+	struct job *job;
+	size_t size;
+	size_t head;
+	size_t count;
+	size_t pending;
+	size_t batch_max;
+};
+
+static struct
+{
+	int binary;
+	int check;
+	int tag;
+	int zero;
+	int ignore_missing;
+	int quiet;
+	int status;
+	int strict;
+	int warn;
+	unsigned jobs;
+	int io;
+} opt;
+
+#define IO_MMAP		0
+#define IO_URING	1
+#define IO_DIRECT	2
+#define IO_NOCACHE	3
+
 /*
- * Resources:
- * https://csrc.nist.gov/pubs/fips/180-4/upd1/final
- * https://en.wikipedia.org/wiki/SHA-2
- * https://datatracker.ietf.org/doc/html/rfc6234
+ * Most files read through one ring at once with --io=uring.
+ */
+
+#define URING_BATCH	16
+
+/*
+ * Counts for the checksum file being verified.
+ */
+
+static struct
+{
+	size_t formatted;
+	size_t misformatted;
+	size_t unreadable;
+	size_t mismatched;
+	size_t matched;
+} stats;
+
+static const char *prog = "sha256sum";
+static int failed;
+
+/**
+ * print_quoted - print a file name for an error message
+ * @f: stream
+ * @s: file name
+ *
+ * Quotes the name the way a shell would need it when it contains anything
+ * unusual, like coreutils does.
+ */
+
+static void print_quoted( FILE *f, const char *s )
+{
+	static const char safe[] = "+,-./0123456789:=@ABCDEFGHIJKLMNOPQRSTUVWXYZ^_abcdefghijklmnopqrstuvwxyz%";
+	int ctrl = 0;
+	int single = 0;
+	int special = 0;
+
+	for ( const char *p = s; *p != '\0'; p++ )
+	{
+		if ( ( unsigned char ) *p < 0x20 || *p == 0x7f )
+			ctrl = 1;
+		else if ( *p == '\'' )
+			single = 1;
+		else if ( strchr( safe, *p ) == NULL )
+			special |= *p == '"' || *p == '$' || *p == '`' || *p == '\\' || *p == '!' ? 2 : 1;
+	}
+
+	if ( *s != '\0' && !ctrl && !single && !special )
+	{
+		fputs( s, f );
+		return;
+	}
+
+	if ( !ctrl && single && !( special & 2 ) )
+	{
+		fprintf( f, "\"%s\"", s );
+		return;
+	}
+
+	fputc( '\'', f );
+
+	for ( const char *p = s; *p != '\0'; p++ )
+	{
+		if ( *p == '\'' )
+			fputs( "'\\''", f );
+		else if ( *p == '\n' )
+			fputs( "'$'\\n''", f );
+		else if ( *p == '\t' )
+			fputs( "'$'\\t''", f );
+		else if ( *p == '\r' )
+			fputs( "'$'\\r''", f );
+		else if ( ( unsigned char ) *p < 0x20 || *p == 0x7f )
+			fprintf( f, "'$'\\%03o''", ( unsigned char ) *p );
+		else
+			fputc( *p, f );
+	}
+
+	fputc( '\'', f );
+}
+
+/**
+ * error_file - report a problem with a file on stderr
+ * @name: file name
+ * @msg: what went wrong
+ */
+
+static void error_file( const char *name, const char *msg )
+{
+	fflush( stdout );
+	fprintf( stderr, "%s: ", prog );
+	print_quoted( stderr, name );
+	fprintf( stderr, ": %s\n", msg );
+}
+
+/**
+ * needs_escape - check if a file name has to be escaped in a sum line
+ * @s: file name
  *
- * https://www.youtube.com/watch?v=orIgy2MjqrA
+ * Lines printed while hashing escape names that contain a backslash or a
+ * newline and start with a backslash to say so, unless -z is given. The
+ * result lines of --check have their own rule, see report_check.
  *
- * https://rbtblog.com/posts/SHA256-Algorithm-Implementation-in-C/
- * https://github.com/B-Con/crypto-algorithms/blob/master/sha256.c
- * https://opensource.apple.com/source/clamav/clamav-158/clamav.Bin/clamav-0.98/libclamav/sha256.c.auto.html
- * https://github.com/amosnier/sha-2/blob/master/sha-256.c
- * https://github.com/openssl/openssl/blob/master/crypto/sha/sha256.c
- * https://android.googlesource.com/platform/system/core/+/669ecc2f5e80ff924fa20ce7445354a7c5bcfd98/libmincrypt/sha256.c
+ * Return: nonzero if the name has to be escaped
+ */
+
+static int needs_escape( const char *s )
+{
+	return !opt.zero && strpbrk( s, "\\\n" ) != NULL;
+}
+
+/**
+ * print_name - print a file name as part of an output line
+ * @s: file name
+ * @escape: whether backslashes and newlines are escaped
  */
 
-void print_message_block( uint8_t *m )
+static void print_name( const char *s, int escape )
 {
-	for ( size_t i = 0; i < 64; i += 4 )
+	if ( !escape )
 	{
-		printf( "%.2x", m[ i + 3 ] ); printf( " " );
-		printf( "%.2x", m[ i + 2 ] ); printf( " " );
-		printf( "%.2x", m[ i + 1 ] ); printf( " " );
-		printf( "%.2x", m[ i     ] ); printf( " " );
-		printf( "\n" );
+		fputs( s, stdout );
+		return;
+	}
+
+	for ( ; *s != '\0'; s++ )
+	{
+		if ( *s == '\\' )
+			fputs( "\\\\", stdout );
+		else if ( *s == '\n' )
+			fputs( "\\n", stdout );
+		else
+			putchar( *s );
 	}
 }
 
-void print_hash( const uint8_t *hash )
+static void print_hex( const uint8_t *md )
 {
-	for ( size_t i = 0; i < 32; i++ )
-		printf( "%02x", hash[ i ] );
-	printf( "\n" );
+	for ( size_t i = 0; i < SHA256_DIGEST_SIZE; i++ )
+		printf( "%02x", md[ i ] );
 }
 
 /*
- * Choose. Using the input from x we will choose which bits to take and return from y and z.
- * If a bit in x is 0 take the bit in the same place from z else take the bit from y.
- * Do this for all 32 bits and return the result.
+ * With --io=uring every thread that hashes files gets its own ring the first
+ * time it needs one. Where io_uring isn't available the reader stays NULL and
+ * the uring functions fall back to sha256_fd. Every ring is also kept in a
+ * list so main can tear them all down at the end.
  */
 
-#define CH( x, y, z ) ( ( ( x ) & ( y ) ) ^ ( ~( x ) & ( z ) ) )
+static __thread struct sha256_uring *ring;
+static __thread int ring_tried;
 
-/*
- * Majority. Using the input from x, y and z, a resulting bit is determined by
- * the majority count of bit values in that column of bits. So, if a column has
- * a 1 for x, a 0 for y, and a 0 for z then the majority is 0 so return 0.
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct sha256_uring **rings;
+static size_t nrings;
+
+static struct sha256_uring *thread_ring( void )
+{
+	struct sha256_uring **grown;
+
+	if ( ring_tried )
+		return ring;
+
+	ring_tried = 1;
+	ring = sha256_uring_create( 0, 0 );
+	if ( ring == NULL )
+		return NULL;
+
+	pthread_mutex_lock( &rings_lock );
+	grown = realloc( rings, ( nrings + 1 ) * sizeof( *rings ) );
+	if ( grown != NULL )
+	{
+		rings = grown;
+		rings[ nrings++ ] = ring;
+	}
+	pthread_mutex_unlock( &rings_lock );
+
+	if ( grown == NULL )
+	{
+		sha256_uring_destroy( ring );
+		ring = NULL;
+	}
+
+	return ring;
+}
+
+static void destroy_rings( void )
+{
+	for ( size_t i = 0; i < nrings; i++ )
+		sha256_uring_destroy( rings[ i ] );
+
+	free( rings );
+	rings = NULL;
+	nrings = 0;
+}
+
+static void hash_task( struct sha256_task *task )
+{
+	struct job *job = ( struct job * ) task;
+	uint8_t *md;
+
+	if ( strcmp( job->name, "-" ) == 0 )
+	{
+		if ( opt.io == IO_URING )
+			md = sha256_uring_fd( thread_ring(), STDIN_FILENO, job->md );
+		else
+			md = sha256_fd( STDIN_FILENO, job->md );
+	}
+	else if ( opt.io == IO_DIRECT )
+		md = sha256_file_flags( job->name, SHA256_FILE_DIRECT | SHA256_FILE_HUGEPAGE, job->md );
+	else if ( opt.io == IO_NOCACHE )
+		md = sha256_file_flags( job->name, SHA256_FILE_NOCACHE | SHA256_FILE_HUGEPAGE, job->md );
+	else
+		md = sha256_file( job->name, job->md );
+
+	job->err = md == NULL ? errno : 0;
+}
+
+/**
+ * batch_task - hash a batch of files through the thread's ring
+ * @task: task of the first job of the batch
+ *
+ * The files are opened up front and read together by sha256_uring_files, so
+ * the reads of one overlap with the hashing of the one before.
  */
 
-#define MAJ( x, y, z ) ( ( ( x ) & ( y ) ) ^ ( ( x ) & ( z ) ) ^ ( ( y ) & ( z ) ) )
+static void batch_task( struct sha256_task *task )
+{
+	struct job *open_job[ URING_BATCH ];
+	int fd[ URING_BATCH ];
+	int err[ URING_BATCH ];
+	uint8_t md[ URING_BATCH * SHA256_DIGEST_SIZE ];
+	size_t n = 0;
 
-/*
- * Rotate right. Similar to right shift of bits but the least significant bit is
- * wrapped around to the most significant bit.
+	for ( struct job *job = ( struct job * ) task; job != NULL; job = job->batch_next )
+	{
+		int f = open( job->name, O_RDONLY );
+
+		if ( f < 0 )
+		{
+			job->err = errno;
+			continue;
+		}
+
+		open_job[ n ] = job;
+		fd[ n++ ] = f;
+	}
+
+	sha256_uring_files( thread_ring(), fd, md, err, n );
+
+	for ( size_t i = 0; i < n; i++ )
+	{
+		open_job[ i ]->err = err[ i ];
+		memcpy( open_job[ i ]->md, &md[ i * SHA256_DIGEST_SIZE ], SHA256_DIGEST_SIZE );
+		close( fd[ i ] );
+	}
+}
+
+/**
+ * report_sum - print the result of hashing a file
+ * @job: finished job
  */
 
-#define ROTR( x, n ) ( ( ( x ) >> ( n ) ) | ( ( x ) << ( 32 - ( n ) ) ) )
+static void report_sum( struct job *job )
+{
+	int escape = needs_escape( job->name );
 
-/*
- * Rotate left. Similar to left shift of bits but the most significant bit is
- * wrapped around to the least significant bit.
+	if ( job->err != 0 )
+	{
+		error_file( job->name, strerror( job->err ) );
+		failed = 1;
+		return;
+	}
+
+	if ( escape )
+		putchar( '\\' );
+
+	if ( opt.tag )
+	{
+		fputs( "SHA256 (", stdout );
+		print_name( job->name, escape );
+		fputs( ") = ", stdout );
+		print_hex( job->md );
+	}
+	else
+	{
+		print_hex( job->md );
+		fputs( opt.binary ? " *" : "  ", stdout );
+		print_name( job->name, escape );
+	}
+
+	putchar( opt.zero ? '\0' : '\n' );
+}
+
+/**
+ * report_check - compare a file's digest with the one it was listed with
+ * @job: finished job
  */
 
-#define ROTL( x, n ) ( ( ( x ) << ( n ) ) | ( ( x ) >> ( 32 - ( n ) ) ) )
+static void report_check( struct job *job )
+{
+	int escape = strchr( job->name, '\n' ) != NULL;
+	const char *result;
 
-/*
- * big sigma functions provided by the sha docs
+	if ( job->err != 0 )
+	{
+		if ( opt.ignore_missing && job->err == ENOENT )
+			return;
+
+		error_file( job->name, strerror( job->err ) );
+		stats.unreadable++;
+		result = "FAILED open or read";
+	}
+	else if ( memcmp( job->md, job->expect, SHA256_DIGEST_SIZE ) != 0 )
+	{
+		stats.mismatched++;
+		result = "FAILED";
+	}
+	else
+	{
+		stats.matched++;
+		if ( opt.quiet )
+			return;
+		result = "OK";
+	}
+
+	if ( opt.status )
+		return;
+
+	if ( escape )
+		putchar( '\\' );
+	print_name( job->name, escape );
+	printf( ": %s\n", result );
+}
+
+/**
+ * queue_flush - hand the jobs of the batch being collected to the pool
+ * @q: queue
  */
 
-#define e0( x ) ( ROTR( ( x ),  2 ) ^ ROTR( ( x ), 13 ) ^ ROTR( ( x ), 22 ) )
-#define e1( x ) ( ROTR( ( x ),  6 ) ^ ROTR( ( x ), 11 ) ^ ROTR( ( x ), 25 ) )
+static void queue_flush( struct queue *q )
+{
+	struct job *lead;
+
+	if ( q->pending == 0 )
+		return;
 
-/*
- * small sigma functions provided by the sha docs
+	lead = &q->job[ ( q->head + q->count - q->pending ) % q->size ];
+	lead->task.fn = batch_task;
+
+	for ( size_t i = 1; i < q->pending; i++ )
+	{
+		struct job *job = &q->job[ ( q->head + q->count - q->pending + i ) % q->size ];
+
+		job->follower = 1;
+		q->job[ ( q->head + q->count - q->pending + i - 1 ) % q->size ].batch_next = job;
+	}
+
+	q->pending = 0;
+	sha256_pool_submit( q->pool, &lead->task );
+}
+
+/**
+ * queue_finish - wait for the oldest job and report it
+ * @q: queue with at least one job in it
  */
 
-#define s0( x ) ( ROTR( ( x ),  7 ) ^ ROTR( ( x ), 18 ) ^ ( ( x ) >>  3 ) )
-#define s1( x ) ( ROTR( ( x ), 17 ) ^ ROTR( ( x ), 19 ) ^ ( ( x ) >> 10 ) )
+static void queue_finish( struct queue *q )
+{
+	struct job *job = &q->job[ q->head ];
 
-/*
- * helper macros
+	if ( q->pending == q->count )
+		queue_flush( q );
+
+	if ( !job->follower )
+		sha256_pool_wait( q->pool, &job->group );
+
+	if ( opt.check )
+		report_check( job );
+	else
+		report_sum( job );
+
+	free( job->owned );
+	job->owned = NULL;
+
+	q->head = ( q->head + 1 ) % q->size;
+	q->count--;
+}
+
+/**
+ * queue_add - start hashing the next file
+ * @q: queue
+ * @name: file name
+ * @owned: NULL, or a copy of the name the job frees when it is done
+ * @expect: digest the file should have in check mode, otherwise NULL
  */
 
-#define BYTESWAP( x )	( ( ROTR( ( x ), 8) & 0xff00ff00 ) | ( ROTL( ( x ), 8 ) & 0x00ff00ffL ) )
-#define MIN( a, b )		( ( a ) < ( b ) ? ( a ) : ( b ) )
-#define MAX( a, b )		( ( a ) > ( b ) ? ( a ) : ( b ) )
+static void queue_add( struct queue *q, const char *name, char *owned, const uint8_t *expect )
+{
+	int stdin_ = strcmp( name, "-" ) == 0;
+	struct job *job;
+
+	/*
+	 * Batches only ever hold jobs at the end of the ring, so the one being
+	 * collected goes out before standard input is hashed in place.
+	 */
+
+	if ( stdin_ )
+		queue_flush( q );
+
+	if ( q->count == q->size )
+		queue_finish( q );
+
+	job = &q->job[ ( q->head + q->count ) % q->size ];
+	q->count++;
+
+	job->task.fn = hash_task;
+	job->task.group = &job->group;
+	job->group.pending = 0;
+	job->name = name;
+	job->owned = owned;
+	job->batch_next = NULL;
+	job->follower = 0;
+	job->err = 0;
+
+	if ( expect != NULL )
+		memcpy( job->expect, expect, SHA256_DIGEST_SIZE );
+
+	if ( stdin_ )
+	{
+		hash_task( &job->task );
+		return;
+	}
+
+	if ( opt.io != IO_URING )
+	{
+		sha256_pool_submit( q->pool, &job->task );
+		return;
+	}
+
+	if ( ++q->pending == q->batch_max )
+		queue_flush( q );
+}
+
+static void queue_drain( struct queue *q )
+{
+	queue_flush( q );
+
+	while ( q->count > 0 )
+		queue_finish( q );
+}
+
+static int hex_value( char c )
+{
+	if ( c >= '0' && c <= '9' )
+		return c - '0';
+	if ( c >= 'a' && c <= 'f' )
+		return c - 'a' + 10;
+	if ( c >= 'A' && c <= 'F' )
+		return c - 'A' + 10;
+	return -1;
+}
 
 /**
- * sha256 - produce a hash sum from data
- * @data: input data to be hashed into sha256
- * @len: length of data in number of bytes
- * @md: output message digest of length 256 bits that needs to be provided by caller
+ * parse_hex - read a hex encoded digest
+ * @s: exactly 64 hex digits
+ * @md: output digest
  *
- * Will generate a hash using the sha256 algorithm given an input with a bit
- * length of l, where 0 <= l < 2^64 bits.
+ * Return: 0 on success, -1 if s isn't a digest
+ */
+
+static int parse_hex( const char *s, uint8_t *md )
+{
+	for ( size_t i = 0; i < SHA256_DIGEST_SIZE; i++ )
+	{
+		int hi = hex_value( s[ 2 * i ] );
+		int lo = hi < 0 ? -1 : hex_value( s[ 2 * i + 1 ] );
+
+		if ( lo < 0 )
+			return -1;
+
+		md[ i ] = ( uint8_t ) ( hi << 4 | lo );
+	}
+
+	return 0;
+}
+
+/**
+ * unescape - undo print_name escaping in place
+ * @s: escaped file name
  *
- * Return: pointer to the message digest
+ * Return: 0 on success, -1 on an invalid escape
  */
 
-uint8_t *sha256( const uint8_t *data, size_t len )
+static int unescape( char *s )
 {
+	char *out = s;
 
-	/*
-	 * These are 64, 32 bit constants for k. These words represent the first 32
-	 * bits of the fractional parts of the cube roots of the first sixty-four prime
-	 * numbers.
-	 */
-	
-	static const uint32_t K[] = {
-		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-	};
+	for ( ; *s != '\0'; s++ )
+	{
+		if ( *s != '\\' )
+		{
+			*out++ = *s;
+			continue;
+		}
 
-	/*
-	 * Hash value. This will be what will hold the intermediate hash value after
-	 * each message block is processed with the last iteration resulting in the
-	 * final hash value. We initialized it with 8, 32 bit constants representing
-	 * the initial hash value. These constants are the first 32 bits of the
-	 * fractional parts of the square roots of the first eight prime numbers.
-	 */
+		s++;
+		if ( *s == '\\' )
+			*out++ = '\\';
+		else if ( *s == 'n' )
+			*out++ = '\n';
+		else
+			return -1;
+	}
 
-	uint32_t H[] = {
-		0x6a09e667,
-		0xbb67ae85,
-		0x3c6ef372,
-		0xa54ff53a,
-		0x510e527f,
-		0x9b05688c,
-		0x1f83d9ab,
-		0x5be0cd19
-	};
+	*out = '\0';
 
-	/*
-	 * Begin processing each message block.
-	 */
+	return 0;
+}
+
+/**
+ * parse_line - split a checksum line into digest and file name
+ * @line: line without its line break, modified in place
+ * @md: output digest
+ *
+ * Accepts both the default format and the BSD style one --tag prints.
+ *
+ * Return: the file name, or NULL if the line is improperly formatted
+ */
+
+static char *parse_line( char *line, uint8_t *md )
+{
+	int escaped = 0;
+	char *name;
+
+	while ( *line == ' ' || *line == '\t' )
+		line++;
+
+	if ( *line == '\\' )
+	{
+		escaped = 1;
+		line++;
+	}
 
-	size_t data_pos = 0;
-	size_t N = ( len / 64 ) + 1 + ( len % 64 >= 56 ? 1 : 0 );
-	for ( size_t i = 1; i <= N; i++ )
+	if ( strncmp( line, "SHA256 (", 8 ) == 0 )
 	{
-		/*
-		 * Message block. Each message block is the i'th block of 512 bits from our input
-		 * data.
-		 */
+		char *end = NULL;
 
-		uint32_t M[ 16 ] = { 0 };
+		name = line + 8;
+		for ( char *p = strstr( name, ") = " ); p != NULL; p = strstr( p + 1, ") = " ) )
+			end = p;
 
-		/*
-		 * Message schedule. This to store our expanded message block. Not
-		 * really sure of the finer details to why we expand it.
-		 */
+		if ( end == NULL || strlen( end + 4 ) != 2 * SHA256_DIGEST_SIZE || parse_hex( end + 4, md ) != 0 )
+			return NULL;
 
-		uint32_t W[ 64 ];
+		*end = '\0';
+	}
+	else
+	{
+		if ( strlen( line ) < 2 * SHA256_DIGEST_SIZE + 2 || parse_hex( line, md ) != 0 )
+			return NULL;
 
-		/*
-		 * Working variables. Used as temporary variables to hold the values we will
-		 * use to update our hash value after compressing our message schedule.
-		 */
+		name = line + 2 * SHA256_DIGEST_SIZE;
+		if ( *name++ != ' ' )
+			return NULL;
 
-		uint32_t a, b, c, d, e, f, g, h, T1, T2;
+		if ( *name == ' ' || *name == '*' )
+			name++;
+	}
 
-		/*
-		 * Prepare the message block using our input data and pad our message
-		 * block if needed.
-		 */
+	if ( *name == '\0' || ( escaped && unescape( name ) != 0 ) )
+		return NULL;
 
-		// copy our data to our message block
-		size_t msgblk_len = MIN( len - data_pos, 64 );
-		if ( msgblk_len > 0 ) memcpy( M, &data[ data_pos ], msgblk_len );
-		data_pos += msgblk_len;
+	return name;
+}
 
-		// pad message
-		if ( ( msgblk_len < 64 && msgblk_len != 0 ) || ( len % 64 == 0 && i == N ) )
-			( ( uint8_t * ) M )[ msgblk_len ] = 0x80;
+/**
+ * check_file - verify every file listed in a checksum file
+ * @q: queue to hash the listed files on
+ * @file: checksum file, "-" for standard input
+ */
 
-		// convert the message to big endian
-		for ( size_t w = 0; w < 16; w++ )
-			M[ w ] = BYTESWAP( M[ w ] );
+static void check_file( struct queue *q, const char *file )
+{
+	int stdin_ = strcmp( file, "-" ) == 0;
+	const char *display = stdin_ ? "standard input" : file;
+	FILE *f = stdin_ ? stdin : fopen( file, "r" );
+	char *line = NULL;
+	size_t cap = 0;
+	ssize_t n;
+	size_t lineno = 0;
+
+	if ( f == NULL )
+	{
+		error_file( file, strerror( errno ) );
+		failed = 1;
+		return;
+	}
+
+	memset( &stats, 0, sizeof( stats ) );
+
+	while ( ( n = getline( &line, &cap, f ) ) > 0 )
+	{
+		uint8_t md[ SHA256_DIGEST_SIZE ];
+		char *name;
 
-		// last 64 bits is the bit length of our message
-		if ( i == N )
+		lineno++;
+
+		if ( line[ 0 ] == '#' )
+			continue;
+
+		if ( line[ n - 1 ] == '\n' )
+			line[ --n ] = '\0';
+		if ( n > 0 && line[ n - 1 ] == '\r' )
+			line[ --n ] = '\0';
+		if ( n == 0 )
+			continue;
+
+		name = parse_line( line, md );
+		if ( name == NULL )
 		{
-			uint64_t bitlen = ( uint64_t ) len * 8;
-			M[ 15 ] = bitlen;
-			M[ 14 ] = bitlen >> 32;
+			stats.misformatted++;
+			if ( opt.warn )
+			{
+				fflush( stdout );
+				fprintf( stderr, "%s: ", prog );
+				print_quoted( stderr, display );
+				fprintf( stderr, ": %zu: improperly formatted SHA256 checksum line\n", lineno );
+			}
+			continue;
 		}
 
-		/*
-		 * Prepare the message schedule using the rules below.
-		 * Wt = Mt												 0 <= t <= 15
-		 *	  = s1(W(t-2)) + W(t-7) + s0(W(t-15)) + W(t-16)		16 <= t <= 63
-		 */
-
-		for ( size_t t =  0; t < 16; t++ ) W[ t ] = M[ t ];
-		for ( size_t t = 16; t < 64; t++ ) W[ t ] = s1( W[ t - 2 ] ) + W[ t - 7 ] + s0( W[ t - 15 ] ) + W[ t - 16 ];
-
-		/*
-		 * Initialize our working variables with our intermediate hash values
-		 */
-
-		a = H[ 0 ];
-		b = H[ 1 ];
-		c = H[ 2 ];
-		d = H[ 3 ];
-		e = H[ 4 ];
-		f = H[ 5 ];
-		g = H[ 6 ];
-		h = H[ 7 ];
-
-		/*
-		 * Compute the working variables. This compresses our message schedule.
-		 */
-
-		for ( int t = 0; t < 64; t++ )
+		stats.formatted++;
+		name = strdup( name );
+		if ( name == NULL )
 		{
-			T1 = h + e1( e ) + CH( e, f, g ) + K[ t ] + W[ t ];
-			T2 = e0( a ) + MAJ( a, b, c );
-			h  = g;
-			g  = f;
-			f  = e;
-			e  = d + T1;
-			d  = c;
-			c  = b;
-			b  = a;
-			a  = T1 + T2;
+			error_file( display, strerror( ENOMEM ) );
+			failed = 1;
+			break;
 		}
 
-		/*
-		 * Update the intermediate hash value with our compressed message block.
-		 */
+		queue_add( q, name, name, md );
+	}
+
+	if ( ferror( f ) )
+	{
+		error_file( display, strerror( errno ) );
+		failed = 1;
+	}
+
+	free( line );
+	if ( !stdin_ )
+		fclose( f );
+
+	queue_drain( q );
 
-		H[ 0 ] += a;
-		H[ 1 ] += b;
-		H[ 2 ] += c;
-		H[ 3 ] += d;
-		H[ 4 ] += e;
-		H[ 5 ] += f;
-		H[ 6 ] += g;
-		H[ 7 ] += h;
+	if ( stats.formatted == 0 )
+	{
+		error_file( display, "no properly formatted checksum lines found" );
+		failed = 1;
+		return;
 	}
 
-	/*
-	 * Copy our final hash value into the message digest and return it. Note
-	 * that our final hash value is in little endian so I convert it to big
-	 * endian before copying it to our message digest.
-	 */
+	if ( !opt.status )
+	{
+		fflush( stdout );
 
-	H[ 0 ] = BYTESWAP( H[ 0 ] );
-	H[ 1 ] = BYTESWAP( H[ 1 ] );
-	H[ 2 ] = BYTESWAP( H[ 2 ] );
-	H[ 3 ] = BYTESWAP( H[ 3 ] );
-	H[ 4 ] = BYTESWAP( H[ 4 ] );
-	H[ 5 ] = BYTESWAP( H[ 5 ] );
-	H[ 6 ] = BYTESWAP( H[ 6 ] );
-	H[ 7 ] = BYTESWAP( H[ 7 ] );
+		if ( stats.misformatted > 0 )
+			fprintf( stderr, "%s: WARNING: %zu %s improperly formatted\n", prog, stats.misformatted,
+					stats.misformatted == 1 ? "line is" : "lines are" );
 
-	static uint8_t md[ 32 ];
-	memcpy( md, H, 32 );
+		if ( stats.unreadable > 0 )
+			fprintf( stderr, "%s: WARNING: %zu listed %s could not be read\n", prog, stats.unreadable,
+					stats.unreadable == 1 ? "file" : "files" );
 
-	return md;
+		if ( stats.mismatched > 0 )
+			fprintf( stderr, "%s: WARNING: %zu computed %s did NOT match\n", prog, stats.mismatched,
+					stats.mismatched == 1 ? "checksum" : "checksums" );
+
+		if ( opt.ignore_missing && stats.matched == 0 )
+			error_file( display, "no file was verified" );
+	}
+
+	if ( stats.matched == 0 || stats.mismatched > 0 || stats.unreadable > 0 || ( opt.strict && stats.misformatted > 0 ) )
+		failed = 1;
 }
 
-int main()
+static void usage( FILE *f )
 {
-	uint8_t *hsh = NULL;
+	fprintf( f,
+		"Usage: %s [OPTION]... [FILE]...\n"
+		"Print or check SHA256 (256-bit) checksums.\n"
+		"\n"
+		"With no FILE, or when FILE is -, read standard input.\n"
+		"  -b, --binary          read in binary mode\n"
+		"  -c, --check           read checksums from the FILEs and check them\n"
+		"      --tag             create a BSD-style checksum\n"
+		"  -t, --text            read in text mode (default)\n"
+		"  -z, --zero            end each output line with NUL, not newline,\n"
+		"                          and disable file name escaping\n"
+		"  -j, --jobs=N          hash up to N files at once (default: one per cpu)\n"
+		"      --io=MODE         how files are read: mmap (default), uring, or\n"
+		"                          direct or nocache to keep them out of the\n"
+		"                          page cache\n"
+		"\n"
+		"The following five options are useful only when verifying checksums:\n"
+		"      --ignore-missing  don't fail or report status for missing files\n"
+		"      --quiet           don't print OK for each successfully verified file\n"
+		"      --status          don't output anything, status code shows success\n"
+		"      --strict          exit non-zero for improperly formatted checksum lines\n"
+		"  -w, --warn            warn about improperly formatted checksum lines\n"
+		"\n"
+		"      --help            display this help and exit\n", prog );
+}
 
-	const size_t msg_len = 1000;
-	uint8_t msg[ msg_len ];
-	for ( size_t i = 0; i < msg_len; i++ ) msg[ i ] = 'a';
+static void usage_error( const char *msg )
+{
+	if ( msg != NULL )
+		fprintf( stderr, "%s: %s\n", prog, msg );
+	fprintf( stderr, "Try '%s --help' for more information.\n", prog );
+	exit( 1 );
+}
 
-	hsh = sha256( msg, msg_len );
-	print_hash( hsh );
+enum
+{
+	OPT_TAG = 256,
+	OPT_IGNORE_MISSING,
+	OPT_QUIET,
+	OPT_STATUS,
+	OPT_STRICT,
+	OPT_IO,
+	OPT_HELP
+};
+
+static const struct option long_options[] =
+{
+	{ "binary",         no_argument,       NULL, 'b' },
+	{ "check",          no_argument,       NULL, 'c' },
+	{ "tag",            no_argument,       NULL, OPT_TAG },
+	{ "text",           no_argument,       NULL, 't' },
+	{ "zero",           no_argument,       NULL, 'z' },
+	{ "jobs",           required_argument, NULL, 'j' },
+	{ "io",             required_argument, NULL, OPT_IO },
+	{ "ignore-missing", no_argument,       NULL, OPT_IGNORE_MISSING },
+	{ "quiet",          no_argument,       NULL, OPT_QUIET },
+	{ "status",         no_argument,       NULL, OPT_STATUS },
+	{ "strict",         no_argument,       NULL, OPT_STRICT },
+	{ "warn",           no_argument,       NULL, 'w' },
+	{ "help",           no_argument,       NULL, OPT_HELP },
+	{ NULL,             0,                 NULL, 0 }
+};
+
+int main( int argc, char **argv )
+{
+	static char *const stdin_only[] = { "-", NULL };
+	struct queue q = { 0 };
+	char *const *files;
+	int c;
 
-	return 0;
+	if ( argv[ 0 ] != NULL && argv[ 0 ][ 0 ] != '\0' )
+	{
+		const char *slash = strrchr( argv[ 0 ], '/' );
+		prog = slash != NULL ? slash + 1 : argv[ 0 ];
+	}
+
+	while ( ( c = getopt_long( argc, argv, "bctzj:w", long_options, NULL ) ) != -1 )
+	{
+		switch ( c )
+		{
+		case 'b': opt.binary = 1; break;
+		case 't': opt.binary = 0; break;
+		case 'c': opt.check = 1; break;
+		case 'z': opt.zero = 1; break;
+		case 'w': opt.warn = 1; opt.status = 0; opt.quiet = 0; break;
+		case OPT_TAG: opt.tag = 1; break;
+		case OPT_IGNORE_MISSING: opt.ignore_missing = 1; break;
+		case OPT_QUIET: opt.quiet = 1; opt.status = 0; opt.warn = 0; break;
+		case OPT_STATUS: opt.status = 1; opt.quiet = 0; opt.warn = 0; break;
+		case OPT_STRICT: opt.strict = 1; break;
+		case OPT_HELP: usage( stdout ); return 0;
+
+		case OPT_IO:
+			if ( strcmp( optarg, "mmap" ) == 0 )
+				opt.io = IO_MMAP;
+			else if ( strcmp( optarg, "uring" ) == 0 )
+				opt.io = IO_URING;
+			else if ( strcmp( optarg, "direct" ) == 0 )
+				opt.io = IO_DIRECT;
+			else if ( strcmp( optarg, "nocache" ) == 0 )
+				opt.io = IO_NOCACHE;
+			else
+			{
+				fprintf( stderr, "%s: invalid io mode: ", prog );
+				print_quoted( stderr, optarg );
+				fputc( '\n', stderr );
+				return 1;
+			}
+			break;
+
+		case 'j':
+		{
+			char *end;
+			unsigned long n = strtoul( optarg, &end, 10 );
+
+			if ( *optarg == '\0' || *end != '\0' || n == 0 || n > 4096 )
+			{
+				fprintf( stderr, "%s: invalid number of jobs: ", prog );
+				print_quoted( stderr, optarg );
+				fputc( '\n', stderr );
+				return 1;
+			}
+
+			opt.jobs = ( unsigned ) n;
+			break;
+		}
+
+		default:
+			usage_error( NULL );
+		}
+	}
+
+	if ( opt.tag && opt.check )
+		usage_error( "the --tag option is meaningless when verifying checksums" );
+	if ( opt.check && opt.zero )
+		usage_error( "the --zero option is not supported when verifying checksums" );
+	if ( !opt.check && opt.ignore_missing )
+		usage_error( "the --ignore-missing option is meaningful only when verifying checksums" );
+	if ( !opt.check && opt.status )
+		usage_error( "the --status option is meaningful only when verifying checksums" );
+	if ( !opt.check && opt.warn )
+		usage_error( "the --warn option is meaningful only when verifying checksums" );
+	if ( !opt.check && opt.quiet )
+		usage_error( "the --quiet option is meaningful only when verifying checksums" );
+	if ( !opt.check && opt.strict )
+		usage_error( "the --strict option is meaningful only when verifying checksums" );
+
+	/*
+	 * The main thread hashes too while it waits for the oldest job, so n jobs
+	 * need n - 1 workers.
+	 */
+
+	if ( opt.jobs > 0 )
+		q.pool = sha256_pool_create( opt.jobs - 1, 0 );
+	else
+		q.pool = sha256_pool_default();
+
+	if ( q.pool == NULL )
+	{
+		fprintf( stderr, "%s: can't start worker threads\n", prog );
+		return 1;
+	}
+
+	q.batch_max = opt.io == IO_URING ? URING_BATCH : 1;
+	q.size = 4 * q.batch_max * ( sha256_pool_threads( q.pool ) + 1 );
+	q.job = calloc( q.size, sizeof( *q.job ) );
+	if ( q.job == NULL )
+	{
+		fprintf( stderr, "%s: %s\n", prog, strerror( ENOMEM ) );
+		return 1;
+	}
+
+	files = optind < argc ? &argv[ optind ] : stdin_only;
+
+	for ( ; *files != NULL; files++ )
+	{
+		if ( opt.check )
+			check_file( &q, *files );
+		else
+			queue_add( &q, *files, NULL, NULL );
+	}
+
+	queue_drain( &q );
+	free( q.job );
+	destroy_rings();
+
+	if ( opt.jobs > 0 )
+		sha256_pool_destroy( q.pool );
+
+	if ( fflush( stdout ) != 0 || ferror( stdout ) )
+	{
+		fprintf( stderr, "%s: write error: %s\n", prog, strerror( errno ) );
+		return 1;
+	}
+
+	return failed;
 }
@@ -0,0 +1,222 @@
+#include <string.h>
+
+#include "sha256.h"
+#include "sha256_internal.h"
+
+/*
+ * sha256 implimentation in c
+ */
+
+/*
+ * Resources:
+ * https://csrc.nist.gov/pubs/fips/180-4/upd1/final
+ * https://en.wikipedia.org/wiki/SHA-2
+ * https://datatracker.ietf.org/doc/html/rfc6234
+ *
+ * https://www.youtube.com/watch?v=orIgy2MjqrA
+ *
+ * https://rbtblog.com/posts/SHA256-Algorithm-Implementation-in-C/
+ * https://github.com/B-Con/crypto-algorithms/blob/master/sha256.c
+ * https://opensource.apple.com/source/clamav/clamav-158/clamav.Bin/clamav-0.98/libclamav/sha256.c.auto.html
+ * https://github.com/amosnier/sha-2/blob/master/sha-256.c
+ * https://github.com/openssl/openssl/blob/master/crypto/sha/sha256.c
+ * https://android.googlesource.com/platform/system/core/+/669ecc2f5e80ff924fa20ce7445354a7c5bcfd98/libmincrypt/sha256.c
+ */
+
+/*
+ * These are 64, 32 bit constants for k. These words represent the first 32
+ * bits of the fractional parts of the cube roots of the first sixty-four prime
+ * numbers.
+ */
+
+const uint32_t sha256_K[ 64 ] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/*
+ * Hash value. This is what every new message starts from. These are 8, 32 bit
+ * constants representing the initial hash value, the first 32 bits of the
+ * fractional parts of the square roots of the first eight prime numbers.
+ */
+
+const uint32_t sha256_H0[ 8 ] = {
+	0x6a09e667,
+	0xbb67ae85,
+	0x3c6ef372,
+	0xa54ff53a,
+	0x510e527f,
+	0x9b05688c,
+	0x1f83d9ab,
+	0x5be0cd19
+};
+
+size_t sha256_pad( uint8_t *blk, const uint8_t *tail, size_t tail_len, uint64_t len )
+{
+	size_t nblocks = tail_len < 56 ? 1 : 2;
+	size_t blk_len = nblocks * 64;
+
+	/*
+	 * Pad message. Append a single 1 bit then zeros until there are exactly
+	 * 64 bits left, which hold the bit length of our message.
+	 */
+
+	memcpy( blk, tail, tail_len );
+	blk[ tail_len ] = 0x80;
+	memset( &blk[ tail_len + 1 ], 0, blk_len - 8 - tail_len - 1 );
+
+	uint64_t bitlen = len * 8;
+	STORE32_BE( &blk[ blk_len - 8 ], ( uint32_t ) ( bitlen >> 32 ) );
+	STORE32_BE( &blk[ blk_len - 4 ], ( uint32_t ) bitlen );
+
+	return nblocks;
+}
+
+void sha256_wipe( void *p, size_t len )
+{
+	volatile uint8_t *v = p;
+
+	while ( len-- )
+		*v++ = 0;
+}
+
+/**
+ * sha256_finish - pad the tail of a message and produce the digest
+ * @H: intermediate hash value after every whole block of the message
+ * @tail: the bytes after the last whole block
+ * @tail_len: length of tail, less than 64
+ * @len: length of the whole message in number of bytes
+ * @md: output message digest
+ *
+ * Padding only ever touches the last one or two blocks so it is built here
+ * once instead of being checked for on every block.
+ */
+
+static void sha256_finish( uint32_t *H, const uint8_t *tail, size_t tail_len, uint64_t len, uint8_t *md )
+{
+	uint8_t blk[ 128 ];
+
+	sha256_compress( H, blk, sha256_pad( blk, tail, tail_len, len ) );
+
+	/*
+	 * Copy our final hash value into the message digest. Note that our final
+	 * hash value is in little endian so I convert it to big endian before
+	 * copying it to our message digest.
+	 */
+
+	for ( size_t i = 0; i < 8; i++ )
+		STORE32_BE( &md[ i * 4 ], H[ i ] );
+}
+
+void sha256_init( struct sha256_ctx *ctx )
+{
+	memcpy( ctx->H, sha256_H0, sizeof( sha256_H0 ) );
+	ctx->len = 0;
+}
+
+void sha256_update( struct sha256_ctx *ctx, const uint8_t *data, size_t len )
+{
+	size_t buf_len = ctx->len % 64;
+	ctx->len += len;
+
+	/*
+	 * Top up a partial block left over from the previous call first. Whole
+	 * blocks are then compressed straight out of the caller's buffer and only
+	 * the leftover tail is kept in the context.
+	 */
+
+	if ( buf_len > 0 )
+	{
+		size_t n = MIN( 64 - buf_len, len );
+		memcpy( &ctx->buf[ buf_len ], data, n );
+		buf_len += n;
+		data += n;
+		len -= n;
+
+		if ( buf_len < 64 )
+			return;
+
+		sha256_compress( ctx->H, ctx->buf, 1 );
+	}
+
+	sha256_compress( ctx->H, data, len / 64 );
+	data += len & ~( size_t ) 63;
+	len &= 63;
+
+	if ( len > 0 )
+		memcpy( ctx->buf, data, len );
+}
+
+void sha256_final( struct sha256_ctx *ctx, uint8_t *md )
+{
+	sha256_finish( ctx->H, ctx->buf, ctx->len % 64, ctx->len, md );
+}
+
+int sha256_export( const struct sha256_ctx *ctx, struct sha256_midstate *ms )
+{
+	if ( ctx->len % 64 != 0 )
+		return -1;
+
+	memcpy( ms->H, ctx->H, sizeof( ms->H ) );
+	ms->len = ctx->len;
+
+	return 0;
+}
+
+void sha256_import( struct sha256_ctx *ctx, const struct sha256_midstate *ms )
+{
+	memcpy( ctx->H, ms->H, sizeof( ctx->H ) );
+	ctx->len = ms->len;
+}
+
+uint8_t *sha256_short( const uint8_t *data, size_t len, uint8_t *md )
+{
+	uint32_t H[ 8 ];
+	uint8_t blk[ 64 ] = { 0 };
+
+	if ( len > SHA256_SHORT_MAX )
+		return sha256( data, len, md );
+
+	/*
+	 * One block, no bulk and no tail bookkeeping. The bit length is under
+	 * 2^9 so it always fits in the last word.
+	 */
+
+	memcpy( blk, data, len );
+	blk[ len ] = 0x80;
+	STORE32_BE( &blk[ 60 ], ( uint32_t ) len * 8 );
+
+	memcpy( H, sha256_H0, sizeof( sha256_H0 ) );
+	sha256_compress( H, blk, 1 );
+
+	for ( size_t i = 0; i < 8; i++ )
+		STORE32_BE( &md[ i * 4 ], H[ i ] );
+
+	return md;
+}
+
+uint8_t *sha256( const uint8_t *data, size_t len, uint8_t *md )
+{
+	uint32_t H[ 8 ];
+	size_t bulk = len & ~( size_t ) 63;
+
+	if ( len <= SHA256_SHORT_MAX )
+		return sha256_short( data, len, md );
+
+	/*
+	 * One shot. Every whole block is compressed in place, only the tail
+	 * ever gets copied.
+	 */
+
+	memcpy( H, sha256_H0, sizeof( sha256_H0 ) );
+	sha256_compress( H, data, len / 64 );
+	sha256_finish( H, &data[ bulk ], len - bulk, len, md );
+
+	return md;
+}
@@ -0,0 +1,163 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * sha256 implimentation in c
+ *
+ * Public interface. Link against build/lib/libsha256.a and include this
+ * header. The hashing functions are safe to call from multiple threads as long
+ * as each thread uses its own context.
+ *
+ * The one piece of global state is the choice of kernels, made when the
+ * library loads and read by every hashing call. sha256_set_kernel,
+ * sha256_set_mb_kernel and sha256_set_avx512_min_batch change it for the
+ * whole process without any locking, so they are not thread-safe. Call them
+ * before starting other threads, or while none of them is hashing.
+ */
+
+#define SHA256_BLOCK_SIZE	64
+#define SHA256_DIGEST_SIZE	32
+
+/*
+ * Streaming context. Holds the intermediate hash value, the number of bytes
+ * absorbed so far and the partial message block that is waiting for more
+ * data. The context owns no heap memory so it can live on the stack or be
+ * embedded in other structures.
+ */
+
+struct sha256_ctx
+{
+	uint32_t H[ 8 ];
+	uint64_t len;
+	uint8_t buf[ SHA256_BLOCK_SIZE ];
+};
+
+/**
+ * sha256_init - prepare a context for a new message
+ * @ctx: context to initialize
+ */
+
+void sha256_init( struct sha256_ctx *ctx );
+
+/**
+ * sha256_update - absorb more of the message
+ * @ctx: context previously passed to sha256_init
+ * @data: next piece of the message
+ * @len: length of data in number of bytes
+ *
+ * May be called any number of times with pieces of any size. Hashing a
+ * message in pieces gives the same digest as hashing it in one go.
+ */
+
+void sha256_update( struct sha256_ctx *ctx, const uint8_t *data, size_t len );
+
+/**
+ * sha256_final - pad the message and produce the digest
+ * @ctx: context holding the message absorbed so far
+ * @md: output message digest of length 256 bits that needs to be provided by caller
+ *
+ * The context must be initialized again before it is reused.
+ */
+
+void sha256_final( struct sha256_ctx *ctx, uint8_t *md );
+
+/*
+ * Intermediate hash value of a message that has been absorbed up to a block
+ * boundary. Messages that start with the same prefix can hash the prefix once,
+ * export the state after it and import that for every message instead of
+ * hashing the prefix again.
+ */
+
+struct sha256_midstate
+{
+	uint32_t H[ 8 ];
+	uint64_t len;
+};
+
+/**
+ * sha256_export - save the state of a context
+ * @ctx: context that has absorbed a whole number of blocks
+ * @ms: output midstate
+ *
+ * Return: 0 on success, -1 if the bytes absorbed so far don't end on a block
+ * boundary
+ */
+
+int sha256_export( const struct sha256_ctx *ctx, struct sha256_midstate *ms );
+
+/**
+ * sha256_import - resume hashing from a saved state
+ * @ctx: context to initialize
+ * @ms: midstate from sha256_export
+ *
+ * Afterwards ctx is in the same state as the one the midstate was exported
+ * from, the next sha256_update continues the message right after the prefix.
+ */
+
+void sha256_import( struct sha256_ctx *ctx, const struct sha256_midstate *ms );
+
+/**
+ * sha256 - produce a hash sum from data
+ * @data: input data to be hashed into sha256
+ * @len: length of data in number of bytes
+ * @md: output message digest of length 256 bits that needs to be provided by caller
+ *
+ * Will generate a hash using the sha256 algorithm given an input with a bit
+ * length of l, where 0 <= l < 2^64 bits.
+ *
+ * Return: pointer to the message digest
+ */
+
+uint8_t *sha256( const uint8_t *data, size_t len, uint8_t *md );
+
+/*
+ * Longest message that fits in a single block along with its padding.
+ */
+
+#define SHA256_SHORT_MAX 55
+
+/**
+ * sha256_short - hash a message that fits in one block
+ * @data: input data to be hashed into sha256
+ * @len: length of data in number of bytes, at most SHA256_SHORT_MAX
+ * @md: output message digest of length 256 bits that needs to be provided by caller
+ *
+ * For session ids, cache keys and other short tokens. Builds the one padded
+ * block on the stack and runs exactly one compression. sha256 takes this path
+ * by itself for short messages, calling it directly just skips the length
+ * check. Longer messages are passed on to sha256.
+ *
+ * Return: pointer to the message digest
+ */
+
+uint8_t *sha256_short( const uint8_t *data, size_t len, uint8_t *md );
+
+/**
+ * sha256_kernel - name of the compression kernel in use
+ *
+ * The fastest kernel the cpu supports is picked when the library loads. The
+ * SHA256_KERNEL environment variable can name a kernel to use instead, one of
+ * "shani", "avx2", "ssse3", "scalar-bmi2" or "scalar". A kernel the cpu can't
+ * run is ignored.
+ *
+ * Return: kernel name
+ */
+
+const char *sha256_kernel( void );
+
+/**
+ * sha256_set_kernel - switch to a different compression kernel
+ * @name: kernel name as reported by sha256_kernel, or NULL for the fastest
+ *
+ * Meant for testing and benchmarking. Not thread-safe, don't call it while
+ * other threads are hashing.
+ *
+ * Return: 0 on success, -1 if the kernel doesn't exist or the cpu can't run it
+ */
+
+int sha256_set_kernel( const char *name );
+
+#endif
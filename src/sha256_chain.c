@@ -0,0 +1,89 @@
+#include <string.h>
+
+#include "sha256_mb.h"
+#include "sha256_internal.h"
+
+/*
+ * Hash chains, x, H( x ), H( H( x ) ), ... for 32 byte x.
+ *
+ * Every step is a single block, the previous digest followed by the same
+ * padding as the second hash of sha256d64. So the digest never has to be
+ * turned back into bytes between steps, its words are the first eight
+ * schedule words of the next block as they are. Bytes are only read at the
+ * start and written at the end.
+ */
+
+#define KW_LOADED( t ) ( sha256_K[ t ] + W[ t ] )
+
+void sha256_chain_scalar( uint8_t *md, uint64_t iter )
+{
+	uint32_t W[ 16 ];
+	uint32_t D[ 8 ];
+	uint32_t a, b, c, d, e, f, g, h;
+
+	for ( size_t i = 0; i < 8; i++ )
+		D[ i ] = LOAD32_BE( &md[ i * 4 ] );
+
+	while ( iter-- > 0 )
+	{
+		for ( size_t i = 0; i < 8; i++ )
+		{
+			W[ i ] = D[ i ];
+			W[ i + 8 ] = sha256_pad32_w[ i ];
+		}
+
+		a = sha256_H0[ 0 ];
+		b = sha256_H0[ 1 ];
+		c = sha256_H0[ 2 ];
+		d = sha256_H0[ 3 ];
+		e = sha256_H0[ 4 ];
+		f = sha256_H0[ 5 ];
+		g = sha256_H0[ 6 ];
+		h = sha256_H0[ 7 ];
+
+		ROUNDS8(  0, KW_LOADED );
+		ROUNDS8(  8, KW_PAD32 );
+		ROUNDS8( 16, KW_NEXT );
+		ROUNDS8( 24, KW_NEXT );
+		ROUNDS8( 32, KW_NEXT );
+		ROUNDS8( 40, KW_NEXT );
+		ROUNDS8( 48, KW_NEXT );
+		ROUNDS8( 56, KW_NEXT );
+
+		D[ 0 ] = sha256_H0[ 0 ] + a;
+		D[ 1 ] = sha256_H0[ 1 ] + b;
+		D[ 2 ] = sha256_H0[ 2 ] + c;
+		D[ 3 ] = sha256_H0[ 3 ] + d;
+		D[ 4 ] = sha256_H0[ 4 ] + e;
+		D[ 5 ] = sha256_H0[ 5 ] + f;
+		D[ 6 ] = sha256_H0[ 6 ] + g;
+		D[ 7 ] = sha256_H0[ 7 ] + h;
+	}
+
+	for ( size_t i = 0; i < 8; i++ )
+		STORE32_BE( &md[ i * 4 ], D[ i ] );
+}
+
+void sha256_chain( uint8_t *md, size_t n, uint64_t iter )
+{
+	const struct sha256_mb_kernel *k = sha256_mb_pick( n );
+	size_t lanes = k->lanes;
+	size_t full = n - n % lanes;
+	uint8_t tmp[ SHA256_MB_MAX_LANES * 32 ];
+
+	for ( size_t i = 0; i < full; i += lanes )
+		k->chain( &md[ i * 32 ], iter );
+
+	/*
+	 * The last few chains go through a full set of lanes, padded out with
+	 * zeros.
+	 */
+
+	if ( full < n )
+	{
+		memcpy( tmp, &md[ full * 32 ], ( n - full ) * 32 );
+		memset( &tmp[ ( n - full ) * 32 ], 0, ( lanes - ( n - full ) ) * 32 );
+		k->chain( tmp, iter );
+		memcpy( &md[ full * 32 ], tmp, ( n - full ) * 32 );
+	}
+}
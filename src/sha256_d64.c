@@ -0,0 +1,175 @@
+#include <string.h>
+
+#include "sha256_mb.h"
+#include "sha256_internal.h"
+
+/*
+ * Double SHA-256 of 64 byte messages, sha256( sha256( m ) ), the hash used
+ * for every node of a Bitcoin style Merkle tree.
+ *
+ * The first hash is two blocks, the message and a padding block that is the
+ * same for every 64 byte message, so that block's schedule is a table of
+ * constants and its rounds need no schedule work at all. The second hash is a
+ * single block, the first digest followed by padding. Its schedule does depend
+ * on the digest, but the padding half of it, words 8 to 15, is constant too.
+ */
+
+const uint32_t sha256_pad64_kw[ 64 ] = {
+	0xc28a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf374,
+	0x649b69c1, 0xf0fe4786, 0x0fe1edc6, 0x240cf254, 0x4fe9346f, 0x6cc984be, 0x61b9411e, 0x16f988fa,
+	0xf2c65152, 0xa88e5a6d, 0xb019fc65, 0xb9d99ec7, 0x9a1231c3, 0xe70eeaa0, 0xfdb1232b, 0xc7353eb0,
+	0x3069bad5, 0xcb976d5f, 0x5a0f118f, 0xdc1eeefd, 0x0a35b689, 0xde0b7a04, 0x58f4ca9d, 0xe15d5b16,
+	0x007f3e86, 0x37088980, 0xa507ea32, 0x6fab9537, 0x17406110, 0x0d8cd6f1, 0xcdaa3b6d, 0xc0bbbe37,
+	0x83613bda, 0xdb48a363, 0x0b02e931, 0x6fd15ca7, 0x521afaca, 0x31338431, 0x6ed41a95, 0x6d437890,
+	0xc39c91f2, 0x9eccabbd, 0xb5c9a0e6, 0x532fb63c, 0xd2c741c6, 0x07237ea3, 0xa4954b68, 0x4c191d76
+};
+
+const uint32_t sha256_pad32_w[ 8 ] = {
+	0x80000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000100
+};
+
+const uint32_t sha256_pad32_kw[ 8 ] = {
+	0x5807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf274
+};
+
+#define KW_LOAD( t ) ( sha256_K[ t ] + ( W[ t ] = LOAD32_BE( &in[ ( t ) * 4 ] ) ) )
+#define KW_LOADED( t ) ( sha256_K[ t ] + W[ t ] )
+
+/**
+ * kw_rounds - compress a block given as K + W for every round
+ * @S: intermediate hash value, updated
+ * @kw: K + W for rounds 0 to 63
+ */
+
+SHA256_INLINE
+void kw_rounds( uint32_t *S, const uint32_t *kw )
+{
+	uint32_t a, b, c, d, e, f, g, h;
+
+	a = S[ 0 ];
+	b = S[ 1 ];
+	c = S[ 2 ];
+	d = S[ 3 ];
+	e = S[ 4 ];
+	f = S[ 5 ];
+	g = S[ 6 ];
+	h = S[ 7 ];
+
+	ROUNDS8(  0, KW_TABLE );
+	ROUNDS8(  8, KW_TABLE );
+	ROUNDS8( 16, KW_TABLE );
+	ROUNDS8( 24, KW_TABLE );
+	ROUNDS8( 32, KW_TABLE );
+	ROUNDS8( 40, KW_TABLE );
+	ROUNDS8( 48, KW_TABLE );
+	ROUNDS8( 56, KW_TABLE );
+
+	S[ 0 ] += a;
+	S[ 1 ] += b;
+	S[ 2 ] += c;
+	S[ 3 ] += d;
+	S[ 4 ] += e;
+	S[ 5 ] += f;
+	S[ 6 ] += g;
+	S[ 7 ] += h;
+}
+
+void sha256_kw_block_scalar( uint32_t *state, const uint32_t *kw )
+{
+	kw_rounds( state, kw );
+}
+
+void sha256d64_scalar( uint8_t *out, const uint8_t *in )
+{
+	uint32_t W[ 16 ];
+	uint32_t S[ 8 ];
+	uint32_t a, b, c, d, e, f, g, h;
+
+	a = sha256_H0[ 0 ];
+	b = sha256_H0[ 1 ];
+	c = sha256_H0[ 2 ];
+	d = sha256_H0[ 3 ];
+	e = sha256_H0[ 4 ];
+	f = sha256_H0[ 5 ];
+	g = sha256_H0[ 6 ];
+	h = sha256_H0[ 7 ];
+
+	ROUNDS8(  0, KW_LOAD );
+	ROUNDS8(  8, KW_LOAD );
+	ROUNDS8( 16, KW_NEXT );
+	ROUNDS8( 24, KW_NEXT );
+	ROUNDS8( 32, KW_NEXT );
+	ROUNDS8( 40, KW_NEXT );
+	ROUNDS8( 48, KW_NEXT );
+	ROUNDS8( 56, KW_NEXT );
+
+	S[ 0 ] = a + sha256_H0[ 0 ];
+	S[ 1 ] = b + sha256_H0[ 1 ];
+	S[ 2 ] = c + sha256_H0[ 2 ];
+	S[ 3 ] = d + sha256_H0[ 3 ];
+	S[ 4 ] = e + sha256_H0[ 4 ];
+	S[ 5 ] = f + sha256_H0[ 5 ];
+	S[ 6 ] = g + sha256_H0[ 6 ];
+	S[ 7 ] = h + sha256_H0[ 7 ];
+
+	kw_rounds( S, sha256_pad64_kw );
+
+	for ( size_t i = 0; i < 8; i++ )
+	{
+		W[ i ] = S[ i ];
+		W[ i + 8 ] = sha256_pad32_w[ i ];
+	}
+
+	a = sha256_H0[ 0 ];
+	b = sha256_H0[ 1 ];
+	c = sha256_H0[ 2 ];
+	d = sha256_H0[ 3 ];
+	e = sha256_H0[ 4 ];
+	f = sha256_H0[ 5 ];
+	g = sha256_H0[ 6 ];
+	h = sha256_H0[ 7 ];
+
+	ROUNDS8(  0, KW_LOADED );
+	ROUNDS8(  8, KW_PAD32 );
+	ROUNDS8( 16, KW_NEXT );
+	ROUNDS8( 24, KW_NEXT );
+	ROUNDS8( 32, KW_NEXT );
+	ROUNDS8( 40, KW_NEXT );
+	ROUNDS8( 48, KW_NEXT );
+	ROUNDS8( 56, KW_NEXT );
+
+	STORE32_BE( &out[  0 ], a + sha256_H0[ 0 ] );
+	STORE32_BE( &out[  4 ], b + sha256_H0[ 1 ] );
+	STORE32_BE( &out[  8 ], c + sha256_H0[ 2 ] );
+	STORE32_BE( &out[ 12 ], d + sha256_H0[ 3 ] );
+	STORE32_BE( &out[ 16 ], e + sha256_H0[ 4 ] );
+	STORE32_BE( &out[ 20 ], f + sha256_H0[ 5 ] );
+	STORE32_BE( &out[ 24 ], g + sha256_H0[ 6 ] );
+	STORE32_BE( &out[ 28 ], h + sha256_H0[ 7 ] );
+}
+
+void sha256d64( uint8_t *out, const uint8_t *in, size_t n )
+{
+	const struct sha256_mb_kernel *k = sha256_mb_pick( n );
+	size_t lanes = k->lanes;
+	size_t full = n - n % lanes;
+	uint8_t tmp_in[ SHA256_MB_MAX_LANES * 64 ];
+	uint8_t tmp_out[ SHA256_MB_MAX_LANES * 32 ];
+
+	for ( size_t i = 0; i < full; i += lanes )
+		k->d64( &out[ i * 32 ], &in[ i * 64 ] );
+
+	/*
+	 * The last few messages go through a full set of lanes, padded out with
+	 * zeros.
+	 */
+
+	if ( full < n )
+	{
+		memcpy( tmp_in, &in[ full * 64 ], ( n - full ) * 64 );
+		memset( &tmp_in[ ( n - full ) * 64 ], 0, ( lanes - ( n - full ) ) * 64 );
+		k->d64( tmp_out, tmp_in );
+		memcpy( &out[ full * 32 ], tmp_out, ( n - full ) * 32 );
+	}
+}
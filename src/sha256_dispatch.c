@@ -0,0 +1,316 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sha256.h"
+#include "sha256_mb.h"
+#include "sha256_internal.h"
+
+#if defined( SHA256_X86 )
+#include <cpuid.h>
+#endif
+
+/*
+ * Runtime kernel selection.
+ *
+ * The cpu is probed once, before main, and sha256_compress is bound to the
+ * fastest kernel it can run. Setting SHA256_KERNEL in the environment to the
+ * name of a kernel forces that kernel instead, as long as the cpu supports
+ * it, which is handy for comparing kernels on the same machine. The
+ * multi-buffer kernel is picked the same way from its own table and
+ * SHA256_MB_KERNEL.
+ */
+
+struct sha256_kernel_entry
+{
+	const char *name;
+	sha256_compress_fn fn;
+	unsigned needs;
+};
+
+#define SHANI_NEEDS ( SHA256_CPU_SHA | SHA256_CPU_SSSE3 | SHA256_CPU_SSE41 )
+
+/*
+ * Every kernel, fastest first.
+ */
+
+static const struct sha256_kernel_entry kernels[] = {
+#if defined( SHA256_X86 )
+	{ "shani",			sha256_compress_shani,			SHANI_NEEDS },
+	{ "avx2",			sha256_compress_avx2,			SHA256_CPU_AVX2 | SHA256_CPU_BMI2 },
+	{ "ssse3",			sha256_compress_ssse3,			SHA256_CPU_SSSE3 },
+	{ "scalar-bmi2",	sha256_compress_scalar_bmi2,	SHA256_CPU_BMI2 },
+#endif
+	{ "scalar",			sha256_compress_scalar,			0 },
+};
+
+#define NUM_KERNELS ( sizeof( kernels ) / sizeof( kernels[ 0 ] ) )
+
+static const struct sha256_kernel_entry *active = &kernels[ NUM_KERNELS - 1 ];
+
+sha256_compress_fn sha256_compress = sha256_compress_scalar;
+
+/*
+ * Multi-buffer kernels, fastest first. Two interleaved SHA-NI streams come
+ * before eight AVX2 lanes, which only make about 1 GB/s where a single SHA-NI
+ * stream does better than 1.2 GB/s, so AVX2 is only picked on cpus without
+ * SHA-NI.
+ */
+
+struct sha256_mb_kernel_entry
+{
+	struct sha256_mb_kernel kernel;
+	unsigned needs;
+	int wide;
+};
+
+static const struct sha256_mb_kernel_entry mb_kernels[] = {
+#if defined( SHA256_X86 )
+	{ { "avx512",	16,	sha256_mb_avx512,	sha256d64_avx512,	sha256_chain_avx512,	sha256_kw_block_avx512 },		SHA256_CPU_AVX512F,	1 },
+	{ { "shani-x2",	2,	sha256_mb_shani_x2,	sha256d64_shani_x2,	sha256_chain_shani_x2,	sha256_kw_block_shani_x2 },		SHANI_NEEDS,		0 },
+	{ { "avx2",		8,	sha256_mb_avx2,		sha256d64_avx2,		sha256_chain_avx2,		sha256_kw_block_avx2 },			SHA256_CPU_AVX2,	0 },
+#endif
+	{ { "serial",	1,	sha256_mb_serial,	sha256d64_scalar,	sha256_chain_scalar,	sha256_kw_block_scalar },		0,					0 },
+};
+
+#define NUM_MB_KERNELS ( sizeof( mb_kernels ) / sizeof( mb_kernels[ 0 ] ) )
+
+const struct sha256_mb_kernel *sha256_mb = &mb_kernels[ NUM_MB_KERNELS - 1 ].kernel;
+const struct sha256_mb_kernel *sha256_mb_narrow = &mb_kernels[ NUM_MB_KERNELS - 1 ].kernel;
+
+/*
+ * Below this many messages a batch stays off the 512 bit registers. Four
+ * rounds of sixteen lanes is about where the extra width makes up for the
+ * lower clock, see SHA256_AVX512_MIN_BATCH.
+ */
+
+#define DEFAULT_WIDE_MIN 64
+
+size_t sha256_mb_wide_min = 0;
+
+unsigned sha256_cpu_features( void )
+{
+	static unsigned features;
+	static int probed;
+
+	if ( probed )
+		return features;
+
+#if defined( SHA256_X86 )
+	unsigned int eax, ebx, ecx, edx;
+	unsigned long long xcr0 = 0;
+	unsigned max_leaf = __get_cpuid_max( 0, NULL );
+
+	if ( max_leaf >= 1 )
+	{
+		__cpuid( 1, eax, ebx, ecx, edx );
+
+		if ( ecx & ( 1u <<  9 ) ) features |= SHA256_CPU_SSSE3;
+		if ( ecx & ( 1u << 19 ) ) features |= SHA256_CPU_SSE41;
+
+		/*
+		 * The wide registers are only usable if the os saves them on a
+		 * context switch, which it reports through xcr0.
+		 */
+
+		if ( ecx & ( 1u << 27 ) )
+		{
+			uint32_t lo, hi;
+			__asm__( "xgetbv" : "=a" ( lo ), "=d" ( hi ) : "c" ( 0 ) );
+			xcr0 = ( ( unsigned long long ) hi << 32 ) | lo;
+		}
+
+		if ( ( ecx & ( 1u << 28 ) ) && ( xcr0 & 0x06 ) == 0x06 )
+			features |= SHA256_CPU_AVX;
+	}
+
+	if ( max_leaf >= 7 )
+	{
+		__cpuid_count( 7, 0, eax, ebx, ecx, edx );
+
+		if ( ( ebx & ( 1u <<  5 ) ) && ( features & SHA256_CPU_AVX ) ) features |= SHA256_CPU_AVX2;
+		if ( ebx & ( 1u <<  8 ) ) features |= SHA256_CPU_BMI2;
+		if ( ebx & ( 1u << 29 ) ) features |= SHA256_CPU_SHA;
+
+		if ( ( xcr0 & 0xe6 ) == 0xe6 )
+		{
+			if ( ebx & ( 1u << 16 ) ) features |= SHA256_CPU_AVX512F;
+			if ( ebx & ( 1u << 31 ) ) features |= SHA256_CPU_AVX512VL;
+		}
+	}
+#endif
+
+	probed = 1;
+	return features;
+}
+
+/**
+ * find_kernel - look up a kernel the cpu can run
+ * @name: kernel name, or NULL for the fastest one
+ *
+ * Return: the kernel, or NULL if there is no such kernel or the cpu can't run it
+ */
+
+static const struct sha256_kernel_entry *find_kernel( const char *name )
+{
+	unsigned features = sha256_cpu_features();
+
+	for ( size_t i = 0; i < NUM_KERNELS; i++ )
+	{
+		if ( ( kernels[ i ].needs & features ) != kernels[ i ].needs )
+			continue;
+
+		if ( name == NULL || strcmp( name, kernels[ i ].name ) == 0 )
+			return &kernels[ i ];
+	}
+
+	return NULL;
+}
+
+/**
+ * find_mb_kernel - look up a multi-buffer kernel the cpu can run
+ * @name: kernel name, or NULL for the fastest one
+ * @narrow: when looking for the fastest one, skip the AVX-512 kernels
+ *
+ * Return: the kernel table entry, or NULL if there is no such kernel or the
+ * cpu can't run it
+ */
+
+static const struct sha256_mb_kernel_entry *find_mb_kernel( const char *name, int narrow )
+{
+	unsigned features = sha256_cpu_features();
+
+	for ( size_t i = 0; i < NUM_MB_KERNELS; i++ )
+	{
+		const struct sha256_mb_kernel_entry *k = &mb_kernels[ i ];
+
+		if ( ( k->needs & features ) != k->needs )
+			continue;
+
+		if ( name != NULL )
+		{
+			if ( strcmp( name, k->kernel.name ) == 0 )
+				return k;
+
+			continue;
+		}
+
+		if ( narrow && k->wide )
+			continue;
+
+		return k;
+	}
+
+	return NULL;
+}
+
+/**
+ * bind_mb_kernel - make a multi-buffer kernel the active one
+ * @k: kernel table entry
+ */
+
+static void bind_mb_kernel( const struct sha256_mb_kernel_entry *k )
+{
+	sha256_mb = &k->kernel;
+	sha256_mb_narrow = k->wide ? &find_mb_kernel( NULL, 1 )->kernel : &k->kernel;
+}
+
+/**
+ * env_size - read a count from the environment
+ * @var: name of the environment variable
+ * @def: value to use when var isn't set or isn't a count
+ *
+ * Like the kernel names, a value that can't be used is ignored rather than
+ * reported, there's no one to report it to before main.
+ *
+ * Return: the count, or def
+ */
+
+static size_t env_size( const char *var, size_t def )
+{
+	const char *s = getenv( var );
+	unsigned long long n;
+	char *end;
+
+	if ( s == NULL || *s < '0' || *s > '9' )
+		return def;
+
+	errno = 0;
+	n = strtoull( s, &end, 10 );
+
+	if ( errno != 0 || *end != '\0' || n > SIZE_MAX )
+		return def;
+
+	return ( size_t ) n;
+}
+
+#if defined( __GNUC__ )
+__attribute__( ( constructor ) )
+#endif
+static void sha256_dispatch_init( void )
+{
+	const struct sha256_kernel_entry *k = NULL;
+	const struct sha256_mb_kernel_entry *mb = NULL;
+	const char *name = getenv( "SHA256_KERNEL" );
+
+	if ( name != NULL && *name != '\0' )
+		k = find_kernel( name );
+
+	if ( k == NULL )
+		k = find_kernel( NULL );
+
+	active = k;
+	sha256_compress = k->fn;
+
+	name = getenv( "SHA256_MB_KERNEL" );
+
+	if ( name != NULL && *name != '\0' )
+		mb = find_mb_kernel( name, 0 );
+
+	if ( mb == NULL )
+		mb = find_mb_kernel( NULL, 0 );
+
+	bind_mb_kernel( mb );
+
+	sha256_mb_wide_min = env_size( "SHA256_AVX512_MIN_BATCH", DEFAULT_WIDE_MIN );
+}
+
+const char *sha256_kernel( void )
+{
+	return active->name;
+}
+
+int sha256_set_kernel( const char *name )
+{
+	const struct sha256_kernel_entry *k = find_kernel( name );
+
+	if ( k == NULL )
+		return -1;
+
+	active = k;
+	sha256_compress = k->fn;
+
+	return 0;
+}
+
+const char *sha256_mb_kernel( void )
+{
+	return sha256_mb->name;
+}
+
+int sha256_set_mb_kernel( const char *name )
+{
+	const struct sha256_mb_kernel_entry *mb = find_mb_kernel( name, 0 );
+
+	if ( mb == NULL )
+		return -1;
+
+	bind_mb_kernel( mb );
+
+	return 0;
+}
+
+void sha256_set_avx512_min_batch( size_t n )
+{
+	sha256_mb_wide_min = n;
+}
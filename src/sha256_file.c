@@ -0,0 +1,483 @@
+#define _GNU_SOURCE
+
+#include <aio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sha256_file.h"
+#include "sha256_internal.h"
+
+#define READ_SIZE ( 64 * 1024 )
+
+/*
+ * Uncached reads go through buffers of one huge page each, two per file so
+ * that one can be read into while the other is hashed. O_DIRECT needs the
+ * buffer, the file offset and the read size aligned to the logical block size
+ * of the device, page alignment covers every device in practice.
+ *
+ * Setting up a buffer like that, let alone one made of huge pages, is far too
+ * slow to do for every file, so released buffers are kept in a small pool for
+ * the next file to use.
+ */
+
+#define BUF_SIZE	( ( size_t ) 2 << 20 )
+#define BUF_ALIGN	4096
+#define POOL_MAX	16
+
+/*
+ * How much is read before the pages behind the cursor are dropped.
+ */
+
+#define DROP_SIZE	( ( off_t ) 8 << 20 )
+
+struct buf
+{
+	uint8_t *p;
+	int huge;
+};
+
+static struct
+{
+	pthread_mutex_t lock;
+	size_t count;
+	struct buf buf[ POOL_MAX ];
+} pool = { PTHREAD_MUTEX_INITIALIZER, 0, { { NULL, 0 } } };
+
+/**
+ * buf_get - take a read buffer from the pool or make a new one
+ * @b: out, the buffer
+ * @huge: nonzero to back a new buffer with huge pages if possible
+ *
+ * Return: 0 on success, -1 with errno set if memory ran out
+ */
+
+static int buf_get( struct buf *b, int huge )
+{
+	pthread_mutex_lock( &pool.lock );
+
+	for ( size_t i = pool.count; i-- > 0; )
+	{
+		if ( pool.buf[ i ].huge >= huge )
+		{
+			*b = pool.buf[ i ];
+			pool.buf[ i ] = pool.buf[ --pool.count ];
+			pthread_mutex_unlock( &pool.lock );
+			return 0;
+		}
+	}
+
+	pthread_mutex_unlock( &pool.lock );
+
+	b->huge = 0;
+
+#if defined( MAP_HUGETLB )
+	if ( huge )
+	{
+		void *p = mmap( NULL, BUF_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+
+		if ( p != MAP_FAILED )
+		{
+			b->p = p;
+			b->huge = 1;
+			return 0;
+		}
+	}
+#endif
+
+	if ( posix_memalign( ( void ** ) &b->p, BUF_ALIGN, BUF_SIZE ) != 0 )
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+
+	/*
+	 * No reserved huge pages, transparent ones might still be available.
+	 */
+
+#if defined( MADV_HUGEPAGE )
+	if ( huge )
+		madvise( b->p, BUF_SIZE, MADV_HUGEPAGE );
+#endif
+
+	return 0;
+}
+
+/**
+ * buf_put - give a read buffer back to the pool
+ * @b: buffer from buf_get
+ */
+
+static void buf_put( struct buf *b )
+{
+	pthread_mutex_lock( &pool.lock );
+
+	if ( pool.count < POOL_MAX )
+	{
+		pool.buf[ pool.count++ ] = *b;
+		pthread_mutex_unlock( &pool.lock );
+		return;
+	}
+
+	pthread_mutex_unlock( &pool.lock );
+
+	if ( b->huge )
+		munmap( b->p, BUF_SIZE );
+	else
+		free( b->p );
+}
+
+/**
+ * hash_mapped - hash a regular file through a mapping
+ * @ctx: context to absorb the file into
+ * @fd: file descriptor
+ * @off: offset to start at
+ * @size: size of the file
+ *
+ * Return: 0 on success, -1 with errno set if the file couldn't be mapped
+ */
+
+static int hash_mapped( struct sha256_ctx *ctx, int fd, off_t off, off_t size )
+{
+	long page = sysconf( _SC_PAGESIZE );
+	off_t start = off - off % ( page > 0 ? page : 4096 );
+	size_t len = ( size_t ) ( size - start );
+	uint8_t *map;
+
+	if ( ( uint64_t ) ( size - start ) > SIZE_MAX )
+	{
+		errno = EFBIG;
+		return -1;
+	}
+
+	map = mmap( NULL, len, PROT_READ, MAP_PRIVATE, fd, start );
+	if ( map == MAP_FAILED )
+		return -1;
+
+	/*
+	 * Ask for aggressive readahead, and for huge pages where the page cache
+	 * can provide them. Both are only hints, failing is fine.
+	 */
+
+	madvise( map, len, MADV_SEQUENTIAL );
+#if defined( MADV_HUGEPAGE )
+	madvise( map, len, MADV_HUGEPAGE );
+#endif
+
+	sha256_update( ctx, &map[ off - start ], len - ( size_t ) ( off - start ) );
+	munmap( map, len );
+
+	return lseek( fd, size, SEEK_SET ) < 0 ? -1 : 0;
+}
+
+/**
+ * hash_read - hash a file by reading it in chunks
+ * @ctx: context to absorb the file into
+ * @fd: file descriptor
+ * @off: offset to pread from, or -1 to read from a pipe or terminal
+ *
+ * Return: 0 on success, -1 with errno set on a read error
+ */
+
+static int hash_read( struct sha256_ctx *ctx, int fd, off_t off )
+{
+	uint8_t buf[ READ_SIZE ];
+
+	for ( ;; )
+	{
+		ssize_t n = off < 0 ? read( fd, buf, sizeof( buf ) ) : pread( fd, buf, sizeof( buf ), off );
+
+		if ( n < 0 && errno == EINTR )
+			continue;
+
+		if ( n < 0 )
+			return -1;
+
+		if ( n == 0 )
+			break;
+
+		sha256_update( ctx, buf, ( size_t ) n );
+		if ( off >= 0 )
+			off += n;
+	}
+
+	return off < 0 || lseek( fd, off, SEEK_SET ) >= 0 ? 0 : -1;
+}
+
+uint8_t *sha256_fd( int fd, uint8_t *md )
+{
+	struct sha256_ctx ctx;
+	struct stat st;
+	off_t off = -1;
+	int err;
+
+	if ( fstat( fd, &st ) < 0 )
+		return NULL;
+
+	if ( S_ISREG( st.st_mode ) )
+		off = lseek( fd, 0, SEEK_CUR );
+
+	sha256_init( &ctx );
+
+	if ( off >= 0 && off < st.st_size && ( uint64_t ) ( st.st_size - off ) >= SHA256_FILE_MMAP_MIN )
+	{
+		err = hash_mapped( &ctx, fd, off, st.st_size );
+
+		/*
+		 * Some file systems can't be mapped, those are read like small files.
+		 */
+
+		if ( err != 0 && ( errno == ENODEV || errno == EACCES || errno == EFBIG ) )
+			err = hash_read( &ctx, fd, off );
+	}
+	else
+	{
+		err = hash_read( &ctx, fd, off );
+	}
+
+	if ( err != 0 )
+		return NULL;
+
+	sha256_final( &ctx, md );
+
+	return md;
+}
+
+/*
+ * A read of one buffer. It runs in the background through POSIX AIO, or
+ * synchronously when it couldn't be queued.
+ */
+
+struct read
+{
+	struct aiocb cb;
+	int sync;
+};
+
+/**
+ * read_start - start reading a buffer's worth of a file
+ * @r: the read
+ * @fd: file descriptor
+ * @p: buffer of BUF_SIZE bytes
+ * @off: offset to read from
+ */
+
+static void read_start( struct read *r, int fd, uint8_t *p, off_t off )
+{
+	memset( &r->cb, 0, sizeof( r->cb ) );
+	r->cb.aio_fildes = fd;
+	r->cb.aio_buf = p;
+	r->cb.aio_nbytes = BUF_SIZE;
+	r->cb.aio_offset = off;
+	r->cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+	r->sync = aio_read( &r->cb ) != 0;
+}
+
+/**
+ * read_wait - wait for a read to finish
+ * @r: read from read_start
+ *
+ * Return: number of bytes read, or -1 with errno set on error
+ */
+
+static ssize_t read_wait( struct read *r )
+{
+	const struct aiocb *list[ 1 ] = { &r->cb };
+	ssize_t n;
+	int err;
+
+	if ( r->sync )
+	{
+		do
+			n = pread( r->cb.aio_fildes, ( void * ) r->cb.aio_buf, r->cb.aio_nbytes, r->cb.aio_offset );
+		while ( n < 0 && errno == EINTR );
+
+		return n;
+	}
+
+	while ( ( err = aio_error( &r->cb ) ) == EINPROGRESS )
+		aio_suspend( list, 1, NULL );
+
+	n = aio_return( &r->cb );
+	if ( n < 0 )
+		errno = err;
+
+	return n;
+}
+
+/**
+ * hash_uncached - hash a file without leaving it in the page cache
+ * @ctx: context to absorb the file into
+ * @fd: file descriptor, opened with O_DIRECT unless drop is set
+ * @drop: drop the pages behind the cursor instead of relying on O_DIRECT
+ * @huge: nonzero to use huge page buffers
+ *
+ * Reads alternate between two buffers. As soon as one buffer has been filled
+ * the read of the next part of the file goes out into the other one, and the
+ * full buffer is hashed while the device works on it. Only one read is ever
+ * in flight, and never at the point where the loop is left.
+ *
+ * Return: 0 on success, -1 with errno set on error
+ */
+
+static int hash_uncached( struct sha256_ctx *ctx, int fd, int drop, int huge )
+{
+	struct buf b[ 2 ];
+	struct read r;
+	off_t off = 0;
+	off_t dropped = 0;
+	unsigned cur = 0;
+	int err = 0;
+
+	if ( buf_get( &b[ 0 ], huge ) != 0 )
+		return -1;
+
+	if ( buf_get( &b[ 1 ], huge ) != 0 )
+	{
+		buf_put( &b[ 0 ] );
+		errno = ENOMEM;
+		return -1;
+	}
+
+	if ( drop )
+		posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+
+	read_start( &r, fd, b[ cur ].p, off );
+
+	for ( ;; )
+	{
+		ssize_t n = read_wait( &r );
+
+		if ( n < 0 )
+		{
+			err = errno;
+			break;
+		}
+
+		if ( n == 0 )
+			break;
+
+		/*
+		 * With O_DIRECT a short read means the end of the file, the next
+		 * read would be from an unaligned offset.
+		 */
+
+		if ( drop || ( size_t ) n == BUF_SIZE )
+			read_start( &r, fd, b[ cur ^ 1 ].p, off + n );
+
+		sha256_update( ctx, b[ cur ].p, ( size_t ) n );
+		off += n;
+		cur ^= 1;
+
+		if ( drop && off - dropped >= DROP_SIZE )
+		{
+			posix_fadvise( fd, dropped, off - dropped, POSIX_FADV_DONTNEED );
+			dropped = off;
+		}
+
+		if ( !drop && ( size_t ) n < BUF_SIZE )
+			break;
+	}
+
+	if ( drop && off > dropped )
+		posix_fadvise( fd, dropped, off - dropped, POSIX_FADV_DONTNEED );
+
+	buf_put( &b[ 0 ] );
+	buf_put( &b[ 1 ] );
+	errno = err;
+
+	return err != 0 ? -1 : 0;
+}
+
+uint8_t *sha256_file_flags( const char *path, unsigned flags, uint8_t *md )
+{
+	int drop = !( flags & SHA256_FILE_DIRECT );
+	struct sha256_ctx ctx;
+	struct stat st;
+	int fd = -1;
+	int err;
+
+	if ( !( flags & ( SHA256_FILE_DIRECT | SHA256_FILE_NOCACHE ) ) )
+		return sha256_file( path, md );
+
+	if ( flags & SHA256_FILE_DIRECT )
+	{
+		fd = open( path, O_RDONLY | O_DIRECT );
+		if ( fd < 0 && errno != EINVAL )
+			return NULL;
+	}
+
+	if ( fd < 0 )
+	{
+		drop = 1;
+		fd = open( path, O_RDONLY );
+		if ( fd < 0 )
+			return NULL;
+	}
+
+	if ( fstat( fd, &st ) < 0 )
+	{
+		err = errno;
+		close( fd );
+		errno = err;
+		return NULL;
+	}
+
+	/*
+	 * Only regular files have a page cache to stay out of.
+	 */
+
+	if ( !S_ISREG( st.st_mode ) )
+	{
+		uint8_t *ret = sha256_fd( fd, md );
+
+		err = errno;
+		close( fd );
+		errno = err;
+		return ret;
+	}
+
+	sha256_init( &ctx );
+	err = hash_uncached( &ctx, fd, drop, ( flags & SHA256_FILE_HUGEPAGE ) != 0 ) != 0 ? errno : 0;
+	close( fd );
+
+	/*
+	 * Some file systems accept O_DIRECT on open and only refuse the reads.
+	 */
+
+	if ( err == EINVAL && !drop )
+		return sha256_file_flags( path, ( flags & ~( unsigned ) SHA256_FILE_DIRECT ) | SHA256_FILE_NOCACHE, md );
+
+	if ( err != 0 )
+	{
+		errno = err;
+		return NULL;
+	}
+
+	sha256_final( &ctx, md );
+
+	return md;
+}
+
+uint8_t *sha256_file( const char *path, uint8_t *md )
+{
+	int fd = open( path, O_RDONLY );
+	uint8_t *ret;
+	int err;
+
+	if ( fd < 0 )
+		return NULL;
+
+	ret = sha256_fd( fd, md );
+	err = errno;
+	close( fd );
+	errno = err;
+
+	return ret;
+}
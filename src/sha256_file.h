@@ -0,0 +1,74 @@
+#ifndef SHA256_FILE_H
+#define SHA256_FILE_H
+
+#include <stdint.h>
+
+#include "sha256.h"
+
+/*
+ * File hashing. Large regular files are mapped into memory and the mapping is
+ * hashed in place, so the data goes from the page cache straight into the
+ * compression function without being copied into a buffer first. Pipes,
+ * terminals and small files are read in chunks instead.
+ */
+
+/*
+ * Regular files smaller than this are read rather than mapped, setting up a
+ * mapping costs more than copying a few pages.
+ */
+
+#define SHA256_FILE_MMAP_MIN	( ( size_t ) 256 * 1024 )
+
+/*
+ * Ways to keep a file out of the page cache, for data that is hashed once and
+ * never read again, so it doesn't push out what other programs keep cached.
+ *
+ * SHA256_FILE_DIRECT opens the file with O_DIRECT and reads it into aligned
+ * buffers, bypassing the page cache entirely. File systems that don't support
+ * O_DIRECT get SHA256_FILE_NOCACHE instead. SHA256_FILE_NOCACHE reads through
+ * the page cache as usual but drops the pages behind the read cursor with
+ * POSIX_FADV_DONTNEED. That also drops pages that were cached before, the
+ * cache ends up without any of the file. SHA256_FILE_HUGEPAGE backs the read
+ * buffers with huge pages where the system has them.
+ */
+
+#define SHA256_FILE_DIRECT		1
+#define SHA256_FILE_NOCACHE		2
+#define SHA256_FILE_HUGEPAGE	4
+
+/**
+ * sha256_fd - hash everything left in an open file
+ * @fd: file descriptor open for reading
+ * @md: output message digest of length 256 bits that needs to be provided by caller
+ *
+ * Hashes from the current file offset to the end of the file and leaves the
+ * offset at the end. A mapped file that gets truncated while it is being
+ * hashed raises SIGBUS, same as for any other mapping.
+ *
+ * Return: pointer to the message digest, or NULL with errno set on error
+ */
+
+uint8_t *sha256_fd( int fd, uint8_t *md );
+
+/**
+ * sha256_file - hash a whole file
+ * @path: file name
+ * @md: output message digest of length 256 bits that needs to be provided by caller
+ *
+ * Return: pointer to the message digest, or NULL with errno set on error
+ */
+
+uint8_t *sha256_file( const char *path, uint8_t *md );
+
+/**
+ * sha256_file_flags - hash a whole file, optionally bypassing the page cache
+ * @path: file name
+ * @flags: SHA256_FILE_* flags, 0 is the same as sha256_file
+ * @md: output message digest of length 256 bits that needs to be provided by caller
+ *
+ * Return: pointer to the message digest, or NULL with errno set on error
+ */
+
+uint8_t *sha256_file_flags( const char *path, unsigned flags, uint8_t *md );
+
+#endif
@@ -0,0 +1,124 @@
+#include <string.h>
+
+#include "sha256_mb.h"
+#include "sha256_internal.h"
+
+/*
+ * Batches of messages that all have the same length, known at compile time.
+ *
+ * With the length fixed, so is the padding, and for the lengths here the
+ * padding never shares a block with the message.
+ *
+ * A 32 byte message is one block, itself followed by the same padding as the
+ * second hash of sha256d64. That is one step of a hash chain, so these go
+ * straight to the kernel's chain entry, which already has K + W for the
+ * padding half of the block as constants.
+ *
+ * The other lengths are whole blocks, followed by a padding block that only
+ * depends on the length. Its schedule is constant and so is K + W for every
+ * one of its rounds, tabled below once per length. The kernel's kw_block
+ * entry runs those rounds with no schedule work at all. For 64 bytes the
+ * table is the one sha256d64 already uses.
+ */
+
+static const uint32_t pad4096_kw[ 64 ] = {
+	0xc28a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19c7174,
+	0x649b69c1, 0x3fbe47a6, 0x0fe1edc6, 0x240cc3cc, 0x4fe9346f, 0x5fb484b2, 0x61b9bf1e, 0xf6f9e0e2,
+	0x904651d2, 0xcf776683, 0xb071aacd, 0x45598de9, 0x6e024795, 0xe1a53a4c, 0x01579c54, 0x7ed2a5d2,
+	0x5543dff8, 0x24306163, 0xcbe96064, 0x088b74dd, 0x8cef495f, 0x27644e60, 0xfa4494c7, 0xc85ad905,
+	0xae229301, 0x3cc6aca8, 0xced0f30e, 0x0054346d, 0xaa185a78, 0xbf2f214a, 0xc070f8f5, 0x2bfa9c81,
+	0x2ee7c2f3, 0x060f5920, 0x19f02ca9, 0xf4d1cc5c, 0x4368bd9b, 0xc154267a, 0xec10f2ef, 0xf0bf5abd,
+	0xb1561710, 0xcc85b5a6, 0x55e9155c, 0xeb7ba3e0, 0x0f037e93, 0x2ae3e945, 0xa2affabf, 0x694563d1
+};
+
+static const uint32_t pad8192_kw[ 64 ] = {
+	0xc28a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19cf174,
+	0x649b69c1, 0x8fbe47c6, 0x0fe1edc6, 0x240ce5cc, 0x4fe9346f, 0x74f484bb, 0x61ba3f1e, 0xf6f998ea,
+	0x304651d2, 0xb27c6671, 0xb079c8cd, 0xe5599e8b, 0x760249a1, 0xe7643e50, 0x2013e05b, 0x80540fa9,
+	0xd873f063, 0x12887e4e, 0x72c58638, 0x0d6f4e3d, 0x6ed96338, 0xe4cdb023, 0xd2085d39, 0x7b42fa9a,
+	0x3922dd58, 0xf940154b, 0x2d1f1944, 0x2181742e, 0xe1b98093, 0xb5f6c541, 0xc62c5663, 0x0d5447f2,
+	0x55c852bb, 0x8f7d8ac3, 0xf4580bae, 0x3e785fb5, 0x8f21e0f6, 0x2ee7d27b, 0xfed708fd, 0xbf171e60,
+	0x3629cccc, 0x20c42e68, 0xbc9cdfe5, 0x4925f9ca, 0x8fa683f8, 0xfbeed5ac, 0x8d43e516, 0x27f84b17
+};
+
+void sha256_batch_32( const uint8_t *const *data, uint8_t *md, size_t n )
+{
+	const struct sha256_mb_kernel *k = sha256_mb_pick( n );
+	size_t lanes = k->lanes;
+	uint8_t tmp[ SHA256_MB_MAX_LANES * 32 ];
+
+	/*
+	 * Full groups are gathered straight into md and hashed in place, the last
+	 * one goes through tmp with its spare lanes rerunning its last message.
+	 */
+
+	for ( size_t i = 0; i < n; i += lanes )
+	{
+		size_t m = MIN( lanes, n - i );
+		uint8_t *buf = m == lanes ? &md[ i * 32 ] : tmp;
+
+		for ( size_t l = 0; l < lanes; l++ )
+			memcpy( &buf[ l * 32 ], data[ i + MIN( l, m - 1 ) ], 32 );
+
+		k->chain( buf, 1 );
+
+		if ( buf == tmp )
+			memcpy( &md[ i * 32 ], tmp, m * 32 );
+	}
+}
+
+/**
+ * batch_fixed - hash a batch of messages of a whole number of blocks
+ * @data: array of n message pointers
+ * @md: output, n message digests of 32 bytes each, back to back
+ * @n: number of messages
+ * @len: length of every message, a multiple of 64
+ * @kw: K + W of the padding block for len
+ */
+
+SHA256_INLINE
+void batch_fixed( const uint8_t *const *data, uint8_t *md, size_t n, size_t len, const uint32_t *kw )
+{
+	const struct sha256_mb_kernel *k = sha256_mb_pick( n );
+	size_t lanes = k->lanes;
+	uint32_t state[ 8 * SHA256_MB_MAX_LANES ];
+	const uint8_t *ptr[ SHA256_MB_MAX_LANES ];
+
+	/*
+	 * Lanes past the end of the last group rerun its last message.
+	 */
+
+	for ( size_t i = 0; i < n; i += lanes )
+	{
+		size_t m = MIN( lanes, n - i );
+
+		for ( size_t l = 0; l < lanes; l++ )
+		{
+			ptr[ l ] = data[ i + MIN( l, m - 1 ) ];
+
+			for ( size_t w = 0; w < 8; w++ )
+				state[ w * lanes + l ] = sha256_H0[ w ];
+		}
+
+		k->blocks( state, ptr, len / 64 );
+		k->kw_block( state, kw );
+
+		for ( size_t l = 0; l < m; l++ )
+		{
+			for ( size_t w = 0; w < 8; w++ )
+				STORE32_BE( &md[ ( i + l ) * 32 + w * 4 ], state[ w * lanes + l ] );
+		}
+	}
+}
+
+#define SHA256_FIXED( LEN, KW ) \
+	void sha256_batch_##LEN( const uint8_t *const *data, uint8_t *md, size_t n ) \
+	{ \
+		batch_fixed( data, md, n, LEN, KW ); \
+	}
+
+SHA256_FIXED( 64, sha256_pad64_kw )
+SHA256_FIXED( 4096, pad4096_kw )
+SHA256_FIXED( 8192, pad8192_kw )
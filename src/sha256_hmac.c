@@ -0,0 +1,213 @@
+#include <string.h>
+
+#include "sha256_hmac.h"
+#include "sha256_mb.h"
+#include "sha256_internal.h"
+
+/*
+ * HMAC-SHA256, see sha256_hmac.h.
+ *
+ * HMAC( K, m ) = H( ( K ^ opad ) || H( ( K ^ ipad ) || m ) )
+ *
+ * where K is the key zero padded to one block, or its digest zero padded if
+ * it is longer than a block.
+ */
+
+#define IPAD 0x36
+#define OPAD 0x5c
+
+/*
+ * Most jobs the manager can hold at once, plus one for the job being
+ * submitted.
+ */
+
+#define BATCH_JOBS ( SHA256_MGR_MAX_LANES + 1 )
+
+struct hmac_job
+{
+	struct sha256_job job;
+	size_t i;
+	int outer;
+	uint8_t md[ SHA256_DIGEST_SIZE ];
+};
+
+struct batch
+{
+	const struct sha256_hmac_key *const *key;
+	uint8_t *md;
+	const uint8_t *const *tag;
+	int *ok;
+	int bad;
+	struct hmac_job *free[ BATCH_JOBS ];
+	size_t nfree;
+};
+
+/**
+ * pad_state - hash one block of key ^ pad
+ * @ms: output midstate
+ * @k: key zero padded to one block
+ * @pad: IPAD or OPAD
+ */
+
+static void pad_state( struct sha256_midstate *ms, const uint8_t *k, uint8_t pad )
+{
+	uint8_t blk[ SHA256_BLOCK_SIZE ];
+
+	for ( size_t i = 0; i < SHA256_BLOCK_SIZE; i++ )
+		blk[ i ] = k[ i ] ^ pad;
+
+	memcpy( ms->H, sha256_H0, sizeof( sha256_H0 ) );
+	ms->len = SHA256_BLOCK_SIZE;
+	sha256_compress( ms->H, blk, 1 );
+
+	sha256_wipe( blk, sizeof( blk ) );
+}
+
+void sha256_hmac_key_init( struct sha256_hmac_key *key, const uint8_t *k, size_t len )
+{
+	uint8_t blk[ SHA256_BLOCK_SIZE ] = { 0 };
+
+	if ( len > SHA256_BLOCK_SIZE )
+		sha256( k, len, blk );
+	else
+		memcpy( blk, k, len );
+
+	pad_state( &key->inner, blk, IPAD );
+	pad_state( &key->outer, blk, OPAD );
+
+	sha256_wipe( blk, sizeof( blk ) );
+}
+
+void sha256_hmac_init( struct sha256_hmac_ctx *h, const struct sha256_hmac_key *key )
+{
+	sha256_import( &h->ctx, &key->inner );
+	h->key = key;
+}
+
+void sha256_hmac_update( struct sha256_hmac_ctx *h, const uint8_t *data, size_t len )
+{
+	sha256_update( &h->ctx, data, len );
+}
+
+void sha256_hmac_final( struct sha256_hmac_ctx *h, uint8_t *md )
+{
+	uint8_t inner[ SHA256_DIGEST_SIZE ];
+
+	sha256_final( &h->ctx, inner );
+	sha256_import( &h->ctx, &h->key->outer );
+	sha256_update( &h->ctx, inner, sizeof( inner ) );
+	sha256_final( &h->ctx, md );
+}
+
+uint8_t *sha256_hmac( const struct sha256_hmac_key *key, const uint8_t *data, size_t len, uint8_t *md )
+{
+	struct sha256_hmac_ctx h;
+
+	sha256_hmac_init( &h, key );
+	sha256_hmac_update( &h, data, len );
+	sha256_hmac_final( &h, md );
+
+	return md;
+}
+
+/**
+ * job_done - move a job that came back from the manager on to its next step
+ * @b: batch
+ * @mgr: manager
+ * @hj: the job
+ *
+ * A finished inner hash goes straight back in as the outer hash, a finished
+ * outer hash is the mac.
+ *
+ * Return: the job the manager handed back in turn, or NULL
+ */
+
+static struct sha256_job *job_done( struct batch *b, struct sha256_mgr *mgr, struct hmac_job *hj )
+{
+	if ( !hj->outer )
+	{
+		hj->outer = 1;
+		sha256_import( &hj->job.ctx, &b->key[ hj->i ]->outer );
+		hj->job.data = hj->md;
+		hj->job.len = SHA256_DIGEST_SIZE;
+		return sha256_mgr_submit( mgr, &hj->job );
+	}
+
+	if ( b->md != NULL )
+		memcpy( &b->md[ hj->i * SHA256_DIGEST_SIZE ], hj->md, SHA256_DIGEST_SIZE );
+
+	if ( b->tag != NULL )
+	{
+		uint8_t diff = 0;
+
+		for ( size_t j = 0; j < SHA256_DIGEST_SIZE; j++ )
+			diff |= hj->md[ j ] ^ b->tag[ hj->i ][ j ];
+
+		b->ok[ hj->i ] = diff == 0;
+		b->bad |= diff != 0;
+	}
+
+	b->free[ b->nfree++ ] = hj;
+
+	return NULL;
+}
+
+/**
+ * batch_run - mac every message of a batch
+ * @b: batch with key, md or tag and ok filled in
+ * @data: array of n message pointers
+ * @len: array of n message lengths in number of bytes
+ * @n: number of messages
+ */
+
+static void batch_run( struct batch *b, const uint8_t *const *data, const size_t *len, size_t n )
+{
+	struct hmac_job jobs[ BATCH_JOBS ];
+	struct sha256_mgr mgr;
+	struct sha256_job *done;
+
+	sha256_mgr_init( &mgr );
+
+	b->nfree = 0;
+	for ( size_t j = 0; j < BATCH_JOBS; j++ )
+		b->free[ b->nfree++ ] = &jobs[ j ];
+
+	for ( size_t i = 0; i < n; i++ )
+	{
+		struct hmac_job *hj = b->free[ --b->nfree ];
+
+		hj->i = i;
+		hj->outer = 0;
+		hj->job.data = data[ i ];
+		hj->job.len = len[ i ];
+		hj->job.flags = SHA256_JOB_LAST;
+		hj->job.md = hj->md;
+		sha256_import( &hj->job.ctx, &b->key[ i ]->inner );
+
+		done = sha256_mgr_submit( &mgr, &hj->job );
+		while ( done != NULL )
+			done = job_done( b, &mgr, ( struct hmac_job * ) done );
+	}
+
+	while ( ( done = sha256_mgr_flush( &mgr ) ) != NULL )
+	{
+		while ( done != NULL )
+			done = job_done( b, &mgr, ( struct hmac_job * ) done );
+	}
+}
+
+void sha256_hmac_batch( const struct sha256_hmac_key *const *key, const uint8_t *const *data, const size_t *len, uint8_t *md, size_t n )
+{
+	struct batch b = { .key = key, .md = md };
+
+	batch_run( &b, data, len, n );
+}
+
+int sha256_hmac_verify_batch( const struct sha256_hmac_key *const *key, const uint8_t *const *data, const size_t *len, const uint8_t *const *tag, int *ok, size_t n )
+{
+	struct batch b = { .key = key, .tag = tag, .ok = ok };
+
+	batch_run( &b, data, len, n );
+
+	return b.bad ? -1 : 0;
+}
@@ -0,0 +1,110 @@
+#ifndef SHA256_HMAC_H
+#define SHA256_HMAC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256.h"
+
+/*
+ * HMAC-SHA256, RFC 2104.
+ *
+ * Every HMAC starts by hashing one block of key ^ ipad and ends by hashing
+ * one block of key ^ opad, both the same for every message under a key. A key
+ * object hashes those two blocks once and keeps the midstates after them, so
+ * each message only costs its own blocks plus the one block of the outer
+ * hash. For short messages that's half the work of the textbook construction.
+ *
+ * A key object is never written to after sha256_hmac_key_init, so one can be
+ * shared by any number of threads.
+ */
+
+struct sha256_hmac_key
+{
+	struct sha256_midstate inner;
+	struct sha256_midstate outer;
+};
+
+struct sha256_hmac_ctx
+{
+	struct sha256_ctx ctx;
+	const struct sha256_hmac_key *key;
+};
+
+/**
+ * sha256_hmac_key_init - precompute the midstates of a key
+ * @key: key object to initialize
+ * @k: the key
+ * @len: length of k in number of bytes, any length is allowed
+ */
+
+void sha256_hmac_key_init( struct sha256_hmac_key *key, const uint8_t *k, size_t len );
+
+/**
+ * sha256_hmac_init - start the mac of a new message
+ * @h: context to initialize
+ * @key: key object, must stay valid until sha256_hmac_final
+ */
+
+void sha256_hmac_init( struct sha256_hmac_ctx *h, const struct sha256_hmac_key *key );
+
+/**
+ * sha256_hmac_update - absorb more of the message
+ * @h: context previously passed to sha256_hmac_init
+ * @data: next piece of the message
+ * @len: length of data in number of bytes
+ */
+
+void sha256_hmac_update( struct sha256_hmac_ctx *h, const uint8_t *data, size_t len );
+
+/**
+ * sha256_hmac_final - produce the mac
+ * @h: context holding the message absorbed so far
+ * @md: output mac of length 256 bits that needs to be provided by caller
+ */
+
+void sha256_hmac_final( struct sha256_hmac_ctx *h, uint8_t *md );
+
+/**
+ * sha256_hmac - mac a message in one go
+ * @key: key object
+ * @data: message
+ * @len: length of data in number of bytes
+ * @md: output mac of length 256 bits that needs to be provided by caller
+ *
+ * Return: pointer to the mac
+ */
+
+uint8_t *sha256_hmac( const struct sha256_hmac_key *key, const uint8_t *data, size_t len, uint8_t *md );
+
+/**
+ * sha256_hmac_batch - mac many messages at once
+ * @key: array of n key objects, the same one may appear any number of times
+ * @data: array of n message pointers
+ * @len: array of n message lengths in number of bytes
+ * @md: output, n macs of 32 bytes each, back to back
+ * @n: number of messages
+ *
+ * The messages go through the multi-buffer job manager, inner and outer
+ * hashes of different messages share the SIMD lanes.
+ */
+
+void sha256_hmac_batch( const struct sha256_hmac_key *const *key, const uint8_t *const *data, const size_t *len, uint8_t *md, size_t n );
+
+/**
+ * sha256_hmac_verify_batch - check many macs at once
+ * @key: array of n key objects
+ * @data: array of n message pointers
+ * @len: array of n message lengths in number of bytes
+ * @tag: array of n pointers to the 32 byte macs to check
+ * @ok: output, n flags, 1 for each mac that matched and 0 for the others
+ * @n: number of messages
+ *
+ * Computed and given macs are compared in constant time.
+ *
+ * Return: 0 if every mac matched, -1 if at least one didn't
+ */
+
+int sha256_hmac_verify_batch( const struct sha256_hmac_key *const *key, const uint8_t *const *data, const size_t *len, const uint8_t *const *tag, int *ok, size_t n );
+
+#endif
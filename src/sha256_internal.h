@@ -0,0 +1,365 @@
+#ifndef SHA256_INTERNAL_H
+#define SHA256_INTERNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Pieces shared between the front end in sha256.c and the compression
+ * kernels. Not part of the public interface.
+ */
+
+#if ( defined( __x86_64__ ) || defined( __i386__ ) ) && defined( __GNUC__ )
+#define SHA256_X86
+#endif
+
+/*
+ * Kernel bodies are written once as an always inlined function and then
+ * instantiated for each instruction set with a target attribute.
+ */
+
+#if defined( __GNUC__ )
+#define SHA256_INLINE static inline __attribute__( ( always_inline ) )
+#else
+#define SHA256_INLINE static inline
+#endif
+
+/*
+ * Choose. Using the input from x we will choose which bits to take and return from y and z.
+ * If a bit in x is 0 take the bit in the same place from z else take the bit from y.
+ * Do this for all 32 bits and return the result.
+ */
+
+#define CH( x, y, z ) ( ( ( x ) & ( y ) ) ^ ( ~( x ) & ( z ) ) )
+
+/*
+ * Majority. Using the input from x, y and z, a resulting bit is determined by
+ * the majority count of bit values in that column of bits. So, if a column has
+ * a 1 for x, a 0 for y, and a 0 for z then the majority is 0 so return 0.
+ */
+
+#define MAJ( x, y, z ) ( ( ( x ) & ( y ) ) ^ ( ( x ) & ( z ) ) ^ ( ( y ) & ( z ) ) )
+
+/*
+ * Rotate right. Similar to right shift of bits but the least significant bit is
+ * wrapped around to the most significant bit. Compilers recognize this pattern
+ * and emit a single ror, or rorx when building for BMI2 which does not touch
+ * the flags and can write to a different register than it reads.
+ */
+
+#define ROTR( x, n ) ( ( ( x ) >> ( n ) ) | ( ( x ) << ( 32 - ( n ) ) ) )
+
+/*
+ * Rotate left. Similar to left shift of bits but the most significant bit is
+ * wrapped around to the least significant bit.
+ */
+
+#define ROTL( x, n ) ( ( ( x ) << ( n ) ) | ( ( x ) >> ( 32 - ( n ) ) ) )
+
+/*
+ * big sigma functions provided by the sha docs
+ */
+
+#define e0( x ) ( ROTR( ( x ),  2 ) ^ ROTR( ( x ), 13 ) ^ ROTR( ( x ), 22 ) )
+#define e1( x ) ( ROTR( ( x ),  6 ) ^ ROTR( ( x ), 11 ) ^ ROTR( ( x ), 25 ) )
+
+/*
+ * small sigma functions provided by the sha docs
+ */
+
+#define s0( x ) ( ROTR( ( x ),  7 ) ^ ROTR( ( x ), 18 ) ^ ( ( x ) >>  3 ) )
+#define s1( x ) ( ROTR( ( x ), 17 ) ^ ROTR( ( x ), 19 ) ^ ( ( x ) >> 10 ) )
+
+/*
+ * helper macros
+ */
+
+#define BYTESWAP( x )	( ( ROTR( ( x ), 8) & 0xff00ff00 ) | ( ROTL( ( x ), 8 ) & 0x00ff00ffL ) )
+#define MIN( a, b )		( ( a ) < ( b ) ? ( a ) : ( b ) )
+#define MAX( a, b )		( ( a ) > ( b ) ? ( a ) : ( b ) )
+
+/*
+ * Read and write 32 bit words stored big endian in a byte array. Loading the
+ * words this way lets us read message blocks straight out of the caller's
+ * buffer without copying them or caring about alignment.
+ */
+
+#if defined( __GNUC__ ) && defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+/*
+ * On little endian machines the compiler gives us a single bswap (or a movbe
+ * load) for this, where the shifts and ors below are left to the optimizer.
+ */
+
+static inline uint32_t LOAD32_BE( const uint8_t *p )
+{
+	uint32_t x;
+	memcpy( &x, p, 4 );
+	return __builtin_bswap32( x );
+}
+
+static inline void STORE32_BE( uint8_t *p, uint32_t x )
+{
+	x = __builtin_bswap32( x );
+	memcpy( p, &x, 4 );
+}
+
+#else
+
+static inline uint32_t LOAD32_BE( const uint8_t *p )
+{
+	return ( ( uint32_t ) p[ 0 ] << 24 ) | ( ( uint32_t ) p[ 1 ] << 16 ) |
+		   ( ( uint32_t ) p[ 2 ] <<  8 ) | ( ( uint32_t ) p[ 3 ]       );
+}
+
+static inline void STORE32_BE( uint8_t *p, uint32_t x )
+{
+	p[ 0 ] = ( uint8_t ) ( x >> 24 );
+	p[ 1 ] = ( uint8_t ) ( x >> 16 );
+	p[ 2 ] = ( uint8_t ) ( x >>  8 );
+	p[ 3 ] = ( uint8_t ) ( x       );
+}
+
+#endif
+
+/*
+ * One round of the compression function. Rather than shuffling all eight
+ * working variables at the end of every round the caller rotates the names it
+ * passes in, so only d and h are written. wk is the schedule word with the
+ * round constant already added. h doubles as T1 so the macro works the same
+ * on plain words and on the GCC vector types the SIMD kernels use.
+ */
+
+#define ROUND( a, b, c, d, e, f, g, h, wk ) do { \
+		( h ) += e1( e ) + CH( e, f, g ) + ( wk ); \
+		( d ) += ( h ); \
+		( h ) += e0( a ) + MAJ( a, b, c ); \
+	} while ( 0 )
+
+/*
+ * Eight rounds, after which the names are back where they started. WK( t )
+ * gives schedule word t with the round constant added.
+ */
+
+#define ROUNDS8( t, WK ) do { \
+		ROUND( a, b, c, d, e, f, g, h, WK( ( t ) + 0 ) ); \
+		ROUND( h, a, b, c, d, e, f, g, WK( ( t ) + 1 ) ); \
+		ROUND( g, h, a, b, c, d, e, f, WK( ( t ) + 2 ) ); \
+		ROUND( f, g, h, a, b, c, d, e, WK( ( t ) + 3 ) ); \
+		ROUND( e, f, g, h, a, b, c, d, WK( ( t ) + 4 ) ); \
+		ROUND( d, e, f, g, h, a, b, c, WK( ( t ) + 5 ) ); \
+		ROUND( c, d, e, f, g, h, a, b, WK( ( t ) + 6 ) ); \
+		ROUND( b, c, d, e, f, g, h, a, WK( ( t ) + 7 ) ); \
+	} while ( 0 )
+
+/*
+ * Schedule word t for t >= 16, computed in place over word t - 16 of a
+ * 16 word circular window named W.
+ * Wt = s1(W(t-2)) + W(t-7) + s0(W(t-15)) + W(t-16)
+ */
+
+#define W_NEXT( t ) \
+	( W[ ( t ) & 15 ] += s1( W[ ( ( t ) -  2 ) & 15 ] ) + W[ ( ( t ) -  7 ) & 15 ] + s0( W[ ( ( t ) - 15 ) & 15 ] ) )
+
+#define KW_NEXT( t ) ( sha256_K[ t ] + W_NEXT( t ) )
+
+
+/*
+ * Round constants and initial hash value, defined in sha256.c.
+ */
+
+extern const uint32_t sha256_K[ 64 ];
+extern const uint32_t sha256_H0[ 8 ];
+
+/**
+ * sha256_pad - build the padded final blocks of a message
+ * @blk: out, room for two blocks
+ * @tail: the bytes after the last whole block
+ * @tail_len: length of tail, less than 64
+ * @len: length of the whole message in number of bytes
+ *
+ * Return: number of blocks written to blk, 1 or 2
+ */
+
+size_t sha256_pad( uint8_t *blk, const uint8_t *tail, size_t tail_len, uint64_t len );
+
+/**
+ * sha256_wipe - clear key material
+ * @p: memory to clear
+ * @len: length of p in number of bytes
+ *
+ * Through a volatile pointer, so the stores aren't dropped as dead.
+ */
+
+void sha256_wipe( void *p, size_t len );
+
+/*
+ * Constant parts of sha256d64, the double hash of a 64 byte message, defined
+ * in sha256_d64.c. The padding block of a 64 byte message never changes, so
+ * its whole schedule is known and sha256_pad64_kw holds K + W for all of its
+ * rounds. The second hash is of a 32 byte digest, its block is the digest
+ * followed by padding words 8 to 15 in sha256_pad32_w, and sha256_pad32_kw
+ * holds K + W for rounds 8 to 15.
+ */
+
+extern const uint32_t sha256_pad64_kw[ 64 ];
+extern const uint32_t sha256_pad32_w[ 8 ];
+extern const uint32_t sha256_pad32_kw[ 8 ];
+
+#define KW_TABLE( t ) ( kw[ t ] )
+#define KW_PAD32( t ) ( sha256_pad32_kw[ ( t ) - 8 ] )
+
+/*
+ * Every compression kernel has this shape. It compresses nblocks whole 64 byte
+ * message blocks from data into the intermediate hash value H. Padding is
+ * always left to the caller.
+ */
+
+typedef void ( *sha256_compress_fn )( uint32_t *H, const uint8_t *data, size_t nblocks );
+
+/*
+ * The kernel picked by the dispatcher in sha256_dispatch.c. It is bound before
+ * main runs so callers can use it without any checks.
+ */
+
+extern sha256_compress_fn sha256_compress;
+
+/*
+ * Cpu features the kernels care about, as reported by sha256_cpu_features.
+ * A feature that needs operating system support for its registers is only
+ * reported when the os has enabled them.
+ */
+
+#define SHA256_CPU_SSSE3		( 1u << 0 )
+#define SHA256_CPU_SSE41		( 1u << 1 )
+#define SHA256_CPU_AVX			( 1u << 2 )
+#define SHA256_CPU_AVX2			( 1u << 3 )
+#define SHA256_CPU_BMI2			( 1u << 4 )
+#define SHA256_CPU_SHA			( 1u << 5 )
+#define SHA256_CPU_AVX512F		( 1u << 6 )
+#define SHA256_CPU_AVX512VL		( 1u << 7 )
+
+/**
+ * sha256_cpu_features - probe the cpu once and report what it can do
+ *
+ * Return: mask of SHA256_CPU_* flags, 0 on anything but x86
+ */
+
+unsigned sha256_cpu_features( void );
+
+/*
+ * Compression kernels. Only call a kernel when sha256_cpu_features reports
+ * everything it needs, the dispatcher takes care of that.
+ */
+
+void sha256_compress_scalar( uint32_t *H, const uint8_t *data, size_t nblocks );
+
+#if defined( SHA256_X86 )
+
+void sha256_compress_scalar_bmi2( uint32_t *H, const uint8_t *data, size_t nblocks );
+void sha256_compress_ssse3( uint32_t *H, const uint8_t *data, size_t nblocks );
+void sha256_compress_avx2( uint32_t *H, const uint8_t *data, size_t nblocks );
+void sha256_compress_shani( uint32_t *H, const uint8_t *data, size_t nblocks );
+
+#endif
+
+/*
+ * Multi-buffer kernels hash several independent messages at once, one per
+ * lane. The intermediate hash values are stored transposed, word i of lane l
+ * lives at state[ i * lanes + l ], so a kernel can load each word of every lane
+ * with a single vector load. data[ l ] points at the next nblocks whole blocks
+ * of lane l. Every lane always gets nblocks blocks, the batch code points
+ * unused lanes at some other lane's data and ignores their result.
+ */
+
+#define SHA256_MB_MAX_LANES 16
+
+typedef void ( *sha256_mb_fn )( uint32_t *state, const uint8_t *const *data, size_t nblocks );
+
+/*
+ * Double hash of exactly lanes 64 byte messages, read back to back from in.
+ * The digests go to out back to back as well.
+ */
+
+typedef void ( *sha256_d64_fn )( uint8_t *out, const uint8_t *in );
+
+/*
+ * Hash chains of exactly lanes 32 byte values, read back to back from md and
+ * replaced by their iter times hashed value.
+ */
+
+typedef void ( *sha256_chain_fn )( uint8_t *md, uint64_t iter );
+
+/*
+ * Compress one block whose K + W is known up front for all 64 rounds, the
+ * same block for every lane. That is the padding block of any message that is
+ * a whole number of blocks long, kw only depends on the length.
+ */
+
+typedef void ( *sha256_kw_fn )( uint32_t *state, const uint32_t *kw );
+
+struct sha256_mb_kernel
+{
+	const char *name;
+	unsigned lanes;
+	sha256_mb_fn blocks;
+	sha256_d64_fn d64;
+	sha256_chain_fn chain;
+	sha256_kw_fn kw_block;
+};
+
+/*
+ * The multi-buffer kernel picked by the dispatcher. Using the 512 bit
+ * registers can lower the clock of the whole core for a while, which only pays
+ * off when there is enough work to fill the lanes. So when sha256_mb is an
+ * AVX-512 kernel, batches of fewer than sha256_mb_wide_min messages go to
+ * sha256_mb_narrow instead, the best kernel that doesn't use them.
+ */
+
+extern const struct sha256_mb_kernel *sha256_mb;
+extern const struct sha256_mb_kernel *sha256_mb_narrow;
+extern size_t sha256_mb_wide_min;
+
+/**
+ * sha256_mb_pick - choose the multi-buffer kernel for a batch
+ * @n: number of messages in the batch
+ *
+ * Return: the kernel to use
+ */
+
+static inline const struct sha256_mb_kernel *sha256_mb_pick( size_t n )
+{
+	return n < sha256_mb_wide_min ? sha256_mb_narrow : sha256_mb;
+}
+
+/*
+ * One lane on top of sha256_compress, for machines without a wide kernel.
+ */
+
+void sha256_mb_serial( uint32_t *state, const uint8_t *const *data, size_t nblocks );
+void sha256d64_scalar( uint8_t *out, const uint8_t *in );
+void sha256_chain_scalar( uint8_t *md, uint64_t iter );
+void sha256_kw_block_scalar( uint32_t *state, const uint32_t *kw );
+
+#if defined( SHA256_X86 )
+
+void sha256_mb_avx2( uint32_t *state, const uint8_t *const *data, size_t nblocks );
+void sha256_mb_avx512( uint32_t *state, const uint8_t *const *data, size_t nblocks );
+void sha256_mb_shani_x2( uint32_t *state, const uint8_t *const *data, size_t nblocks );
+
+void sha256d64_avx2( uint8_t *out, const uint8_t *in );
+void sha256d64_avx512( uint8_t *out, const uint8_t *in );
+void sha256d64_shani_x2( uint8_t *out, const uint8_t *in );
+
+void sha256_chain_avx2( uint8_t *md, uint64_t iter );
+void sha256_chain_avx512( uint8_t *md, uint64_t iter );
+void sha256_chain_shani_x2( uint8_t *md, uint64_t iter );
+
+void sha256_kw_block_avx2( uint32_t *state, const uint32_t *kw );
+void sha256_kw_block_avx512( uint32_t *state, const uint32_t *kw );
+void sha256_kw_block_shani_x2( uint32_t *state, const uint32_t *kw );
+
+#endif
+
+#endif
@@ -0,0 +1,39 @@
+#include <errno.h>
+
+#include "sha256_iov.h"
+#include "sha256_internal.h"
+
+/*
+ * sha256_update already does exactly the staging we want, it only copies
+ * into the context's block buffer to top up a block left partial by the
+ * previous call and to keep the tail, and it compresses every whole block
+ * straight out of the caller's memory. So a vector of segments is one update
+ * per segment.
+ */
+
+uint8_t *sha256_iov( const struct iovec *iov, int n, uint8_t *md )
+{
+	struct sha256_ctx ctx;
+
+	if ( n < 0 )
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	/*
+	 * A single segment is just a contiguous message.
+	 */
+
+	if ( n == 1 )
+		return sha256( iov[ 0 ].iov_base, iov[ 0 ].iov_len, md );
+
+	sha256_init( &ctx );
+
+	for ( int i = 0; i < n; i++ )
+		sha256_update( &ctx, iov[ i ].iov_base, iov[ i ].iov_len );
+
+	sha256_final( &ctx, md );
+
+	return md;
+}
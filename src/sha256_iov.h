@@ -0,0 +1,26 @@
+#ifndef SHA256_IOV_H
+#define SHA256_IOV_H
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "sha256.h"
+
+/**
+ * sha256_iov - hash a message held in several buffers
+ * @iov: array of n segments, the message is their concatenation in order
+ * @n: number of segments
+ * @md: output message digest of length 256 bits that needs to be provided by caller
+ *
+ * Gives the same digest as copying every segment into one array and calling
+ * sha256 on it, without the copy. Whole blocks are hashed in place inside each
+ * segment, only a block that straddles two segments is put together in the
+ * block buffer. Segments may be empty.
+ *
+ * Return: pointer to the message digest, or NULL with errno set to EINVAL if
+ * n is negative
+ */
+
+uint8_t *sha256_iov( const struct iovec *iov, int n, uint8_t *md );
+
+#endif
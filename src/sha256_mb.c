@@ -0,0 +1,145 @@
+#include <string.h>
+
+#include "sha256_mb.h"
+#include "sha256_internal.h"
+
+/*
+ * Batch driver for the multi-buffer kernels.
+ *
+ * Each lane works through its message in two runs of blocks: the whole blocks
+ * read straight from the caller's buffer, then the one or two padded blocks
+ * built in the lane's tail buffer. The kernel is always called for as many
+ * blocks as the shortest run has left, after which at least one lane moves on
+ * to its tail or to the next message.
+ */
+
+#define IDLE ( ( size_t ) -1 )
+
+struct lane
+{
+	size_t msg;
+	const uint8_t *p;
+	size_t blocks;
+	size_t tail_blocks;
+	uint8_t tail[ 128 ];
+};
+
+void sha256_mb_serial( uint32_t *state, const uint8_t *const *data, size_t nblocks )
+{
+	sha256_compress( state, data[ 0 ], nblocks );
+}
+
+/**
+ * lane_start - put a message in a lane
+ * @ln: lane
+ * @state: transposed state of every lane
+ * @l: lane number
+ * @lanes: number of lanes
+ * @msg: message index, or IDLE to leave the lane empty with the initial state
+ * @data: the message
+ * @len: length of the message in number of bytes
+ */
+
+static void lane_start( struct lane *ln, uint32_t *state, size_t l, size_t lanes,
+		size_t msg, const uint8_t *data, size_t len )
+{
+	size_t bulk = len & ~( size_t ) 63;
+
+	/*
+	 * An idle lane still runs through the kernel on another lane's data,
+	 * so it gets a defined state like the others.
+	 */
+
+	for ( size_t i = 0; i < 8; i++ )
+		state[ i * lanes + l ] = sha256_H0[ i ];
+
+	ln->msg = msg;
+	if ( msg == IDLE )
+		return;
+
+	ln->p = data;
+	ln->blocks = len / 64;
+	ln->tail_blocks = sha256_pad( ln->tail, &data[ bulk ], len - bulk, len );
+}
+
+void sha256_batch( const uint8_t *const *data, const size_t *len, uint8_t *md, size_t n )
+{
+	const struct sha256_mb_kernel *k = sha256_mb_pick( n );
+	size_t lanes = k->lanes;
+
+	struct lane lane[ SHA256_MB_MAX_LANES ];
+	uint32_t state[ 8 * SHA256_MB_MAX_LANES ];
+	const uint8_t *ptr[ SHA256_MB_MAX_LANES ];
+	size_t next = 0;
+
+	for ( size_t l = 0; l < lanes; l++, next++ )
+	{
+		if ( next < n )
+			lane_start( &lane[ l ], state, l, lanes, next, data[ next ], len[ next ] );
+		else
+			lane_start( &lane[ l ], state, l, lanes, IDLE, NULL, 0 );
+	}
+
+	for ( ;; )
+	{
+		size_t step = IDLE;
+		const uint8_t *any = NULL;
+
+		/*
+		 * Move every lane that ran out of blocks on to its tail, or finish
+		 * its message and start the next one.
+		 */
+
+		for ( size_t l = 0; l < lanes; l++ )
+		{
+			struct lane *ln = &lane[ l ];
+
+			while ( ln->msg != IDLE && ln->blocks == 0 )
+			{
+				if ( ln->tail_blocks > 0 )
+				{
+					ln->p = ln->tail;
+					ln->blocks = ln->tail_blocks;
+					ln->tail_blocks = 0;
+					continue;
+				}
+
+				for ( size_t i = 0; i < 8; i++ )
+					STORE32_BE( &md[ ln->msg * 32 + i * 4 ], state[ i * lanes + l ] );
+
+				if ( next < n )
+				{
+					lane_start( ln, state, l, lanes, next, data[ next ], len[ next ] );
+					next++;
+				}
+				else
+				{
+					ln->msg = IDLE;
+				}
+			}
+
+			if ( ln->msg != IDLE )
+			{
+				step = MIN( step, ln->blocks );
+				any = ln->p;
+			}
+		}
+
+		if ( any == NULL )
+			break;
+
+		for ( size_t l = 0; l < lanes; l++ )
+			ptr[ l ] = lane[ l ].msg != IDLE ? lane[ l ].p : any;
+
+		k->blocks( state, ptr, step );
+
+		for ( size_t l = 0; l < lanes; l++ )
+		{
+			if ( lane[ l ].msg == IDLE )
+				continue;
+
+			lane[ l ].p += step * 64;
+			lane[ l ].blocks -= step;
+		}
+	}
+}
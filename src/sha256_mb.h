@@ -0,0 +1,212 @@
+#ifndef SHA256_MB_H
+#define SHA256_MB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256.h"
+
+/*
+ * Multi-buffer hashing. A single message can't be spread over SIMD lanes
+ * since every block depends on the one before it, but separate messages
+ * can. These functions hash many independent messages at once, one per lane
+ * of the widest kernel the cpu supports.
+ */
+
+/**
+ * sha256_batch - hash many independent messages
+ * @data: array of n message pointers
+ * @len: array of n message lengths in number of bytes
+ * @md: output, n message digests of 32 bytes each, back to back
+ * @n: number of messages
+ *
+ * Messages may all have different lengths. As a lane's message finishes the
+ * next waiting message takes over that lane, so short messages don't hold up
+ * the long ones. Gives the same digests as calling sha256 on each message.
+ */
+
+void sha256_batch( const uint8_t *const *data, const size_t *len, uint8_t *md, size_t n );
+
+/**
+ * sha256_batch_32 - hash many messages of one fixed length
+ * @data: array of n message pointers, each message 32 bytes long
+ * @md: output, n message digests of 32 bytes each, back to back
+ * @n: number of messages
+ *
+ * Same as sha256_batch with every length set to the one in the name, and the
+ * same for sha256_batch_64, sha256_batch_4096 and sha256_batch_8192. The
+ * padding is known at compile time, and so is the part of the message
+ * schedule that only depends on it. The padding block of the longer lengths
+ * takes no schedule work at all.
+ */
+
+void sha256_batch_32( const uint8_t *const *data, uint8_t *md, size_t n );
+void sha256_batch_64( const uint8_t *const *data, uint8_t *md, size_t n );
+void sha256_batch_4096( const uint8_t *const *data, uint8_t *md, size_t n );
+void sha256_batch_8192( const uint8_t *const *data, uint8_t *md, size_t n );
+
+/**
+ * sha256d64 - double hash many 64 byte messages
+ * @out: output, n digests of 32 bytes each, back to back
+ * @in: n messages of 64 bytes each, back to back
+ * @n: number of messages
+ *
+ * Computes sha256( sha256( m ) ) for each message, which is how the nodes of
+ * a Bitcoin style Merkle tree are hashed from the pair of digests below them.
+ * Much faster than two sha256 calls per message since the padding, and most
+ * of the message schedule that depends on it, is precomputed. out may be the
+ * same as in, so a level of a Merkle tree can be hashed in place.
+ */
+
+void sha256d64( uint8_t *out, const uint8_t *in, size_t n );
+
+/**
+ * sha256_chain - walk many hash chains
+ * @md: n values of 32 bytes each, back to back, replaced by the results
+ * @n: number of chains
+ * @iter: number of times to hash each value
+ *
+ * Replaces each value x by H( H( ... H( x ) ) ), hashed iter times, the way
+ * one time password seeds and hash based signature keys are derived. The
+ * chains run side by side in the lanes of the multi-buffer kernel and stay in
+ * registers from one step to the next, so a step costs one compression and
+ * nothing else.
+ */
+
+void sha256_chain( uint8_t *md, size_t n, uint64_t iter );
+
+/**
+ * sha256_mb_kernel - name of the multi-buffer kernel in use
+ *
+ * Picked when the library loads, one of "avx512", "shani-x2", "avx2" or
+ * "serial". The SHA256_MB_KERNEL environment variable can name a kernel to
+ * use instead.
+ *
+ * Return: kernel name
+ */
+
+const char *sha256_mb_kernel( void );
+
+/**
+ * sha256_set_mb_kernel - switch to a different multi-buffer kernel
+ * @name: kernel name as reported by sha256_mb_kernel, or NULL for the default
+ *
+ * Meant for testing and benchmarking. Not thread-safe, don't call it while
+ * other threads are hashing.
+ *
+ * Return: 0 on success, -1 if the kernel doesn't exist or the cpu can't run it
+ */
+
+int sha256_set_mb_kernel( const char *name );
+
+/**
+ * sha256_set_avx512_min_batch - smallest batch worth running on AVX-512
+ * @n: number of messages, 0 to always use AVX-512 when it is picked
+ *
+ * Running the 512 bit units drops the core to a lower clock for a while, which
+ * slows down everything else on it. Batches of fewer than n messages use the
+ * best kernel that stays off the 512 bit registers instead. Defaults to 64,
+ * or to the SHA256_AVX512_MIN_BATCH environment variable when it is set to a
+ * number.
+ *
+ * Not thread-safe, don't call it while other threads are hashing.
+ */
+
+void sha256_set_avx512_min_batch( size_t n );
+
+/*
+ * Job manager. For callers that come up with messages one at a time rather
+ * than as an array. Jobs are handed to the manager with sha256_mgr_submit and
+ * sit in a lane of the widest multi-buffer kernel until every lane is taken,
+ * only then are blocks actually hashed. Finished jobs are handed back by later
+ * submit or flush calls, not necessarily in the order they went in.
+ *
+ * A message can be submitted in several pieces, each one a separate submit of
+ * the same job with the next piece. SHA256_JOB_FIRST starts a new message and
+ * SHA256_JOB_LAST pads it and writes the digest, a piece in the middle has
+ * neither flag. The job must have come back from the manager before it is
+ * submitted again.
+ */
+
+#define SHA256_JOB_UPDATE	0
+#define SHA256_JOB_FIRST	1
+#define SHA256_JOB_LAST		2
+#define SHA256_JOB_ENTIRE	( SHA256_JOB_FIRST | SHA256_JOB_LAST )
+
+#define SHA256_JOB_COMPLETE		0
+#define SHA256_JOB_PROCESSING	1
+
+#define SHA256_MGR_MAX_LANES	16
+
+/*
+ * The caller fills in data, len, flags and md, and may use user for anything.
+ * The rest belongs to the manager while the job is in it. Once a job has come
+ * back ctx holds the message absorbed so far, so a job submitted without
+ * SHA256_JOB_LAST can also be finished with sha256_update and sha256_final.
+ */
+
+struct sha256_job
+{
+	const uint8_t *data;
+	size_t len;
+	unsigned flags;
+	uint8_t *md;
+	void *user;
+
+	int status;
+	struct sha256_ctx ctx;
+
+	struct
+	{
+		const uint8_t *p;
+		size_t blocks;
+	} run[ 3 ];
+	unsigned runs;
+	uint8_t block[ SHA256_BLOCK_SIZE ];
+	uint8_t tail[ 2 * SHA256_BLOCK_SIZE ];
+};
+
+struct sha256_mgr
+{
+	const struct sha256_mb_kernel *kernel;
+	unsigned lanes;
+	unsigned busy;
+	struct sha256_job *lane[ SHA256_MGR_MAX_LANES ];
+	uint32_t state[ 8 * SHA256_MGR_MAX_LANES ];
+};
+
+/**
+ * sha256_mgr_init - prepare an empty job manager
+ * @mgr: manager to initialize
+ *
+ * The manager binds to the multi-buffer kernel in use at this point.
+ */
+
+void sha256_mgr_init( struct sha256_mgr *mgr );
+
+/**
+ * sha256_mgr_submit - hand a job to the manager
+ * @mgr: manager
+ * @job: job with data, len, flags and md filled in
+ *
+ * The data must stay valid until the job comes back. A piece that doesn't
+ * complete a block is only buffered, so such a job comes straight back.
+ *
+ * Return: a finished job, which need not be the one just submitted, or NULL
+ */
+
+struct sha256_job *sha256_mgr_submit( struct sha256_mgr *mgr, struct sha256_job *job );
+
+/**
+ * sha256_mgr_flush - finish a job without waiting for the lanes to fill up
+ * @mgr: manager
+ *
+ * Runs the kernel with whatever lanes are taken until one of the jobs is
+ * done. Call it until it returns NULL to get every job back.
+ *
+ * Return: a finished job, or NULL when the manager is empty
+ */
+
+struct sha256_job *sha256_mgr_flush( struct sha256_mgr *mgr );
+
+#endif
@@ -0,0 +1,330 @@
+#include "sha256_internal.h"
+
+#if defined( SHA256_X86 )
+
+#include <immintrin.h>
+
+/*
+ * AVX2 multi-buffer kernel.
+ *
+ * SHA-256 is serial within one message, but nothing stops us from running
+ * eight different messages side by side, one per 32 bit lane of a ymm
+ * register. Every working variable and schedule word is a vector holding that
+ * value for all eight messages, so the rounds are the exact same macros the
+ * scalar kernel uses, just on GCC vector types. The only extra work is
+ * turning eight rows of message words into eight columns when a block is
+ * loaded.
+ */
+
+#define AVX2_TARGET __attribute__( ( target( "avx2" ) ) )
+
+typedef uint32_t v8u32 __attribute__( ( vector_size( 32 ) ) );
+
+/**
+ * load_words - load 8 words from each of the 8 lanes and transpose them
+ * @W: out, W[ i ] holds word i of every lane
+ * @data: lane pointers
+ * @off: byte offset into each lane
+ */
+
+SHA256_INLINE AVX2_TARGET
+void load_words( v8u32 *W, const uint8_t *const *data, size_t off )
+{
+	const __m256i BSWAP = _mm256_set_epi8(
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3 );
+
+	__m256i r[ 8 ], t[ 8 ], u[ 8 ];
+
+	for ( size_t l = 0; l < 8; l++ )
+		r[ l ] = _mm256_loadu_si256( ( const __m256i * ) &data[ l ][ off ] );
+
+	for ( size_t l = 0; l < 8; l += 2 )
+	{
+		t[ l     ] = _mm256_unpacklo_epi32( r[ l ], r[ l + 1 ] );
+		t[ l + 1 ] = _mm256_unpackhi_epi32( r[ l ], r[ l + 1 ] );
+	}
+
+	for ( size_t l = 0; l < 8; l += 4 )
+	{
+		u[ l     ] = _mm256_unpacklo_epi64( t[ l     ], t[ l + 2 ] );
+		u[ l + 1 ] = _mm256_unpackhi_epi64( t[ l     ], t[ l + 2 ] );
+		u[ l + 2 ] = _mm256_unpacklo_epi64( t[ l + 1 ], t[ l + 3 ] );
+		u[ l + 3 ] = _mm256_unpackhi_epi64( t[ l + 1 ], t[ l + 3 ] );
+	}
+
+	for ( size_t i = 0; i < 4; i++ )
+	{
+		W[ i     ] = ( v8u32 ) _mm256_shuffle_epi8( _mm256_permute2x128_si256( u[ i ], u[ i + 4 ], 0x20 ), BSWAP );
+		W[ i + 4 ] = ( v8u32 ) _mm256_shuffle_epi8( _mm256_permute2x128_si256( u[ i ], u[ i + 4 ], 0x31 ), BSWAP );
+	}
+}
+
+#define KW_LOADED( t ) ( sha256_K[ t ] + W[ t ] )
+
+AVX2_TARGET
+void sha256_mb_avx2( uint32_t *state, const uint8_t *const *data, size_t nblocks )
+{
+	v8u32 W[ 16 ];
+	v8u32 a, b, c, d, e, f, g, h;
+	v8u32 S[ 8 ];
+
+	for ( size_t i = 0; i < 8; i++ )
+		S[ i ] = ( v8u32 ) _mm256_loadu_si256( ( const __m256i * ) &state[ i * 8 ] );
+
+	for ( size_t off = 0; off < nblocks * 64; off += 64 )
+	{
+		load_words( &W[ 0 ], data, off );
+		load_words( &W[ 8 ], data, off + 32 );
+
+		a = S[ 0 ];
+		b = S[ 1 ];
+		c = S[ 2 ];
+		d = S[ 3 ];
+		e = S[ 4 ];
+		f = S[ 5 ];
+		g = S[ 6 ];
+		h = S[ 7 ];
+
+		ROUNDS8(  0, KW_LOADED );
+		ROUNDS8(  8, KW_LOADED );
+		ROUNDS8( 16, KW_NEXT );
+		ROUNDS8( 24, KW_NEXT );
+		ROUNDS8( 32, KW_NEXT );
+		ROUNDS8( 40, KW_NEXT );
+		ROUNDS8( 48, KW_NEXT );
+		ROUNDS8( 56, KW_NEXT );
+
+		S[ 0 ] += a;
+		S[ 1 ] += b;
+		S[ 2 ] += c;
+		S[ 3 ] += d;
+		S[ 4 ] += e;
+		S[ 5 ] += f;
+		S[ 6 ] += g;
+		S[ 7 ] += h;
+	}
+
+	for ( size_t i = 0; i < 8; i++ )
+		_mm256_storeu_si256( ( __m256i * ) &state[ i * 8 ], ( __m256i ) S[ i ] );
+}
+
+/**
+ * kw_rounds - compress a block given as K + W for every round
+ * @S: intermediate hash values of every lane, updated
+ * @kw: K + W for rounds 0 to 63, the same for every lane
+ */
+
+SHA256_INLINE AVX2_TARGET
+void kw_rounds( v8u32 *S, const uint32_t *kw )
+{
+	v8u32 a, b, c, d, e, f, g, h;
+
+	a = S[ 0 ];
+	b = S[ 1 ];
+	c = S[ 2 ];
+	d = S[ 3 ];
+	e = S[ 4 ];
+	f = S[ 5 ];
+	g = S[ 6 ];
+	h = S[ 7 ];
+
+	ROUNDS8(  0, KW_TABLE );
+	ROUNDS8(  8, KW_TABLE );
+	ROUNDS8( 16, KW_TABLE );
+	ROUNDS8( 24, KW_TABLE );
+	ROUNDS8( 32, KW_TABLE );
+	ROUNDS8( 40, KW_TABLE );
+	ROUNDS8( 48, KW_TABLE );
+	ROUNDS8( 56, KW_TABLE );
+
+	S[ 0 ] += a;
+	S[ 1 ] += b;
+	S[ 2 ] += c;
+	S[ 3 ] += d;
+	S[ 4 ] += e;
+	S[ 5 ] += f;
+	S[ 6 ] += g;
+	S[ 7 ] += h;
+}
+
+AVX2_TARGET
+void sha256_kw_block_avx2( uint32_t *state, const uint32_t *kw )
+{
+	v8u32 S[ 8 ];
+
+	for ( size_t i = 0; i < 8; i++ )
+		S[ i ] = ( v8u32 ) _mm256_loadu_si256( ( const __m256i * ) &state[ i * 8 ] );
+
+	kw_rounds( S, kw );
+
+	for ( size_t i = 0; i < 8; i++ )
+		_mm256_storeu_si256( ( __m256i * ) &state[ i * 8 ], ( __m256i ) S[ i ] );
+}
+
+/*
+ * Double hash of 8 64 byte messages, see sha256_d64.c.
+ */
+
+AVX2_TARGET
+void sha256d64_avx2( uint8_t *out, const uint8_t *in )
+{
+	const uint8_t *data[ 8 ];
+	uint32_t state[ 8 * 8 ];
+	v8u32 W[ 16 ];
+	v8u32 a, b, c, d, e, f, g, h;
+	v8u32 H0[ 8 ], S[ 8 ];
+
+	for ( size_t l = 0; l < 8; l++ )
+		data[ l ] = &in[ l * 64 ];
+
+	for ( size_t i = 0; i < 8; i++ )
+		H0[ i ] = ( v8u32 ) _mm256_set1_epi32( ( int ) sha256_H0[ i ] );
+
+	load_words( &W[ 0 ], data, 0 );
+	load_words( &W[ 8 ], data, 32 );
+
+	a = H0[ 0 ];
+	b = H0[ 1 ];
+	c = H0[ 2 ];
+	d = H0[ 3 ];
+	e = H0[ 4 ];
+	f = H0[ 5 ];
+	g = H0[ 6 ];
+	h = H0[ 7 ];
+
+	ROUNDS8(  0, KW_LOADED );
+	ROUNDS8(  8, KW_LOADED );
+	ROUNDS8( 16, KW_NEXT );
+	ROUNDS8( 24, KW_NEXT );
+	ROUNDS8( 32, KW_NEXT );
+	ROUNDS8( 40, KW_NEXT );
+	ROUNDS8( 48, KW_NEXT );
+	ROUNDS8( 56, KW_NEXT );
+
+	S[ 0 ] = a + H0[ 0 ];
+	S[ 1 ] = b + H0[ 1 ];
+	S[ 2 ] = c + H0[ 2 ];
+	S[ 3 ] = d + H0[ 3 ];
+	S[ 4 ] = e + H0[ 4 ];
+	S[ 5 ] = f + H0[ 5 ];
+	S[ 6 ] = g + H0[ 6 ];
+	S[ 7 ] = h + H0[ 7 ];
+
+	kw_rounds( S, sha256_pad64_kw );
+
+	for ( size_t i = 0; i < 8; i++ )
+	{
+		W[ i ] = S[ i ];
+		W[ i + 8 ] = ( v8u32 ) _mm256_set1_epi32( ( int ) sha256_pad32_w[ i ] );
+	}
+
+	a = H0[ 0 ];
+	b = H0[ 1 ];
+	c = H0[ 2 ];
+	d = H0[ 3 ];
+	e = H0[ 4 ];
+	f = H0[ 5 ];
+	g = H0[ 6 ];
+	h = H0[ 7 ];
+
+	ROUNDS8(  0, KW_LOADED );
+	ROUNDS8(  8, KW_PAD32 );
+	ROUNDS8( 16, KW_NEXT );
+	ROUNDS8( 24, KW_NEXT );
+	ROUNDS8( 32, KW_NEXT );
+	ROUNDS8( 40, KW_NEXT );
+	ROUNDS8( 48, KW_NEXT );
+	ROUNDS8( 56, KW_NEXT );
+
+	S[ 0 ] = H0[ 0 ] + a;
+	S[ 1 ] = H0[ 1 ] + b;
+	S[ 2 ] = H0[ 2 ] + c;
+	S[ 3 ] = H0[ 3 ] + d;
+	S[ 4 ] = H0[ 4 ] + e;
+	S[ 5 ] = H0[ 5 ] + f;
+	S[ 6 ] = H0[ 6 ] + g;
+	S[ 7 ] = H0[ 7 ] + h;
+
+	for ( size_t i = 0; i < 8; i++ )
+		_mm256_storeu_si256( ( __m256i * ) &state[ i * 8 ], ( __m256i ) S[ i ] );
+
+	for ( size_t l = 0; l < 8; l++ )
+	{
+		for ( size_t i = 0; i < 8; i++ )
+			STORE32_BE( &out[ l * 32 + i * 4 ], state[ i * 8 + l ] );
+	}
+}
+
+/*
+ * Hash chains, see sha256_chain.c. The digest words stay in registers as the
+ * next block's first eight schedule words.
+ */
+
+AVX2_TARGET
+void sha256_chain_avx2( uint8_t *md, uint64_t iter )
+{
+	const uint8_t *data[ 8 ];
+	uint32_t state[ 8 * 8 ];
+	v8u32 W[ 16 ];
+	v8u32 a, b, c, d, e, f, g, h;
+	v8u32 H0[ 8 ], D[ 8 ], PAD[ 8 ];
+
+	for ( size_t i = 0; i < 8; i++ )
+	{
+		H0[ i ] = ( v8u32 ) _mm256_set1_epi32( ( int ) sha256_H0[ i ] );
+		PAD[ i ] = ( v8u32 ) _mm256_set1_epi32( ( int ) sha256_pad32_w[ i ] );
+	}
+
+	for ( size_t l = 0; l < 8; l++ )
+		data[ l ] = &md[ l * 32 ];
+
+	load_words( D, data, 0 );
+
+	while ( iter-- > 0 )
+	{
+		for ( size_t i = 0; i < 8; i++ )
+		{
+			W[ i ] = D[ i ];
+			W[ i + 8 ] = PAD[ i ];
+		}
+
+		a = H0[ 0 ];
+		b = H0[ 1 ];
+		c = H0[ 2 ];
+		d = H0[ 3 ];
+		e = H0[ 4 ];
+		f = H0[ 5 ];
+		g = H0[ 6 ];
+		h = H0[ 7 ];
+
+		ROUNDS8(  0, KW_LOADED );
+		ROUNDS8(  8, KW_PAD32 );
+		ROUNDS8( 16, KW_NEXT );
+		ROUNDS8( 24, KW_NEXT );
+		ROUNDS8( 32, KW_NEXT );
+		ROUNDS8( 40, KW_NEXT );
+		ROUNDS8( 48, KW_NEXT );
+		ROUNDS8( 56, KW_NEXT );
+
+		D[ 0 ] = H0[ 0 ] + a;
+		D[ 1 ] = H0[ 1 ] + b;
+		D[ 2 ] = H0[ 2 ] + c;
+		D[ 3 ] = H0[ 3 ] + d;
+		D[ 4 ] = H0[ 4 ] + e;
+		D[ 5 ] = H0[ 5 ] + f;
+		D[ 6 ] = H0[ 6 ] + g;
+		D[ 7 ] = H0[ 7 ] + h;
+	}
+
+	for ( size_t i = 0; i < 8; i++ )
+		_mm256_storeu_si256( ( __m256i * ) &state[ i * 8 ], ( __m256i ) D[ i ] );
+
+	for ( size_t l = 0; l < 8; l++ )
+	{
+		for ( size_t i = 0; i < 8; i++ )
+			STORE32_BE( &md[ l * 32 + i * 4 ], state[ i * 8 + l ] );
+	}
+}
+
+#endif
@@ -0,0 +1,385 @@
+#include "sha256_internal.h"
+
+#if defined( SHA256_X86 )
+
+#include <immintrin.h>
+
+/*
+ * AVX-512 multi-buffer kernel.
+ *
+ * Same idea as the AVX2 kernel but sixteen messages wide. AVX-512F has a
+ * real vector rotate (vprord) and a three input logic instruction
+ * (vpternlogd), so ROTR, CH, MAJ and the three way xor in the sigma functions
+ * each become a single instruction. Those macros are redefined below for this
+ * file only, after which the shared round macros work as they are.
+ *
+ * Everything here only needs AVX-512F. The byte swap on load uses two rotates
+ * and a bit select rather than vpshufb, which would need AVX-512BW.
+ */
+
+#define AVX512_TARGET __attribute__( ( target( "avx512f" ) ) )
+
+typedef uint32_t v16u32 __attribute__( ( vector_size( 64 ) ) );
+
+#define TERNLOG( x, y, z, imm ) \
+	( ( v16u32 ) _mm512_ternarylogic_epi32( ( __m512i ) ( x ), ( __m512i ) ( y ), ( __m512i ) ( z ), imm ) )
+
+#undef ROTR
+#define ROTR( x, n )		( ( v16u32 ) _mm512_ror_epi32( ( __m512i ) ( x ), n ) )
+
+#undef ROTL
+#define ROTL( x, n )		( ( v16u32 ) _mm512_rol_epi32( ( __m512i ) ( x ), n ) )
+
+#define XOR3( x, y, z )		TERNLOG( x, y, z, 0x96 )
+
+#undef CH
+#define CH( x, y, z )		TERNLOG( x, y, z, 0xca )
+
+#undef MAJ
+#define MAJ( x, y, z )		TERNLOG( x, y, z, 0xe8 )
+
+#undef e0
+#define e0( x )				XOR3( ROTR( ( x ),  2 ), ROTR( ( x ), 13 ), ROTR( ( x ), 22 ) )
+
+#undef e1
+#define e1( x )				XOR3( ROTR( ( x ),  6 ), ROTR( ( x ), 11 ), ROTR( ( x ), 25 ) )
+
+#undef s0
+#define s0( x )				XOR3( ROTR( ( x ),  7 ), ROTR( ( x ), 18 ), ( x ) >>  3 )
+
+#undef s1
+#define s1( x )				XOR3( ROTR( ( x ), 17 ), ROTR( ( x ), 19 ), ( x ) >> 10 )
+
+/*
+ * Take bytes 1 and 3 of each word from the right rotate and bytes 0 and 2
+ * from the left rotate.
+ */
+
+#undef BYTESWAP
+#define BYTESWAP( x )		TERNLOG( ( v16u32 ) _mm512_set1_epi32( ( int ) 0xff00ff00 ), ROTR( ( x ), 8 ), ROTL( ( x ), 8 ), 0xca )
+
+/**
+ * load_words - load a block from each of the 16 lanes and transpose it
+ * @W: out, W[ i ] holds word i of every lane
+ * @data: lane pointers
+ * @off: byte offset into each lane
+ */
+
+SHA256_INLINE AVX512_TARGET
+void load_words( v16u32 *W, const uint8_t *const *data, size_t off )
+{
+	__m512i r[ 16 ], t[ 16 ], u[ 16 ];
+
+	for ( size_t l = 0; l < 16; l++ )
+		r[ l ] = _mm512_loadu_si512( ( const void * ) &data[ l ][ off ] );
+
+	/*
+	 * After these two steps each 128 bit chunk c of u[ 4 * g + j ] holds word
+	 * j + 4 * c of lanes 4 * g to 4 * g + 3.
+	 */
+
+	for ( size_t l = 0; l < 16; l += 2 )
+	{
+		t[ l     ] = _mm512_unpacklo_epi32( r[ l ], r[ l + 1 ] );
+		t[ l + 1 ] = _mm512_unpackhi_epi32( r[ l ], r[ l + 1 ] );
+	}
+
+	for ( size_t l = 0; l < 16; l += 4 )
+	{
+		u[ l     ] = _mm512_unpacklo_epi64( t[ l     ], t[ l + 2 ] );
+		u[ l + 1 ] = _mm512_unpackhi_epi64( t[ l     ], t[ l + 2 ] );
+		u[ l + 2 ] = _mm512_unpacklo_epi64( t[ l + 1 ], t[ l + 3 ] );
+		u[ l + 3 ] = _mm512_unpackhi_epi64( t[ l + 1 ], t[ l + 3 ] );
+	}
+
+	/*
+	 * What's left is a 4x4 transpose of 128 bit chunks.
+	 */
+
+	for ( size_t j = 0; j < 4; j++ )
+	{
+		__m512i v0 = _mm512_shuffle_i32x4( u[ j     ], u[ j + 4  ], 0x44 );
+		__m512i v1 = _mm512_shuffle_i32x4( u[ j     ], u[ j + 4  ], 0xee );
+		__m512i v2 = _mm512_shuffle_i32x4( u[ j + 8 ], u[ j + 12 ], 0x44 );
+		__m512i v3 = _mm512_shuffle_i32x4( u[ j + 8 ], u[ j + 12 ], 0xee );
+
+		W[ j      ] = BYTESWAP( _mm512_shuffle_i32x4( v0, v2, 0x88 ) );
+		W[ j +  4 ] = BYTESWAP( _mm512_shuffle_i32x4( v0, v2, 0xdd ) );
+		W[ j +  8 ] = BYTESWAP( _mm512_shuffle_i32x4( v1, v3, 0x88 ) );
+		W[ j + 12 ] = BYTESWAP( _mm512_shuffle_i32x4( v1, v3, 0xdd ) );
+	}
+}
+
+#define KW_LOADED( t ) ( sha256_K[ t ] + W[ t ] )
+
+AVX512_TARGET
+void sha256_mb_avx512( uint32_t *state, const uint8_t *const *data, size_t nblocks )
+{
+	v16u32 W[ 16 ];
+	v16u32 a, b, c, d, e, f, g, h;
+	v16u32 S[ 8 ];
+
+	for ( size_t i = 0; i < 8; i++ )
+		S[ i ] = ( v16u32 ) _mm512_loadu_si512( ( const void * ) &state[ i * 16 ] );
+
+	for ( size_t off = 0; off < nblocks * 64; off += 64 )
+	{
+		load_words( W, data, off );
+
+		a = S[ 0 ];
+		b = S[ 1 ];
+		c = S[ 2 ];
+		d = S[ 3 ];
+		e = S[ 4 ];
+		f = S[ 5 ];
+		g = S[ 6 ];
+		h = S[ 7 ];
+
+		ROUNDS8(  0, KW_LOADED );
+		ROUNDS8(  8, KW_LOADED );
+		ROUNDS8( 16, KW_NEXT );
+		ROUNDS8( 24, KW_NEXT );
+		ROUNDS8( 32, KW_NEXT );
+		ROUNDS8( 40, KW_NEXT );
+		ROUNDS8( 48, KW_NEXT );
+		ROUNDS8( 56, KW_NEXT );
+
+		S[ 0 ] += a;
+		S[ 1 ] += b;
+		S[ 2 ] += c;
+		S[ 3 ] += d;
+		S[ 4 ] += e;
+		S[ 5 ] += f;
+		S[ 6 ] += g;
+		S[ 7 ] += h;
+	}
+
+	for ( size_t i = 0; i < 8; i++ )
+		_mm512_storeu_si512( ( void * ) &state[ i * 16 ], ( __m512i ) S[ i ] );
+}
+
+/**
+ * kw_rounds - compress a block given as K + W for every round
+ * @S: intermediate hash values of every lane, updated
+ * @kw: K + W for rounds 0 to 63, the same for every lane
+ */
+
+SHA256_INLINE AVX512_TARGET
+void kw_rounds( v16u32 *S, const uint32_t *kw )
+{
+	v16u32 a, b, c, d, e, f, g, h;
+
+	a = S[ 0 ];
+	b = S[ 1 ];
+	c = S[ 2 ];
+	d = S[ 3 ];
+	e = S[ 4 ];
+	f = S[ 5 ];
+	g = S[ 6 ];
+	h = S[ 7 ];
+
+	ROUNDS8(  0, KW_TABLE );
+	ROUNDS8(  8, KW_TABLE );
+	ROUNDS8( 16, KW_TABLE );
+	ROUNDS8( 24, KW_TABLE );
+	ROUNDS8( 32, KW_TABLE );
+	ROUNDS8( 40, KW_TABLE );
+	ROUNDS8( 48, KW_TABLE );
+	ROUNDS8( 56, KW_TABLE );
+
+	S[ 0 ] += a;
+	S[ 1 ] += b;
+	S[ 2 ] += c;
+	S[ 3 ] += d;
+	S[ 4 ] += e;
+	S[ 5 ] += f;
+	S[ 6 ] += g;
+	S[ 7 ] += h;
+}
+
+AVX512_TARGET
+void sha256_kw_block_avx512( uint32_t *state, const uint32_t *kw )
+{
+	v16u32 S[ 8 ];
+
+	for ( size_t i = 0; i < 8; i++ )
+		S[ i ] = ( v16u32 ) _mm512_loadu_si512( ( const void * ) &state[ i * 16 ] );
+
+	kw_rounds( S, kw );
+
+	for ( size_t i = 0; i < 8; i++ )
+		_mm512_storeu_si512( ( void * ) &state[ i * 16 ], ( __m512i ) S[ i ] );
+}
+
+/*
+ * Double hash of 16 64 byte messages, see sha256_d64.c.
+ */
+
+AVX512_TARGET
+void sha256d64_avx512( uint8_t *out, const uint8_t *in )
+{
+	const uint8_t *data[ 16 ];
+	uint32_t state[ 8 * 16 ];
+	v16u32 W[ 16 ];
+	v16u32 a, b, c, d, e, f, g, h;
+	v16u32 H0[ 8 ], S[ 8 ];
+
+	for ( size_t l = 0; l < 16; l++ )
+		data[ l ] = &in[ l * 64 ];
+
+	for ( size_t i = 0; i < 8; i++ )
+		H0[ i ] = ( v16u32 ) _mm512_set1_epi32( ( int ) sha256_H0[ i ] );
+
+	load_words( W, data, 0 );
+
+	a = H0[ 0 ];
+	b = H0[ 1 ];
+	c = H0[ 2 ];
+	d = H0[ 3 ];
+	e = H0[ 4 ];
+	f = H0[ 5 ];
+	g = H0[ 6 ];
+	h = H0[ 7 ];
+
+	ROUNDS8(  0, KW_LOADED );
+	ROUNDS8(  8, KW_LOADED );
+	ROUNDS8( 16, KW_NEXT );
+	ROUNDS8( 24, KW_NEXT );
+	ROUNDS8( 32, KW_NEXT );
+	ROUNDS8( 40, KW_NEXT );
+	ROUNDS8( 48, KW_NEXT );
+	ROUNDS8( 56, KW_NEXT );
+
+	S[ 0 ] = a + H0[ 0 ];
+	S[ 1 ] = b + H0[ 1 ];
+	S[ 2 ] = c + H0[ 2 ];
+	S[ 3 ] = d + H0[ 3 ];
+	S[ 4 ] = e + H0[ 4 ];
+	S[ 5 ] = f + H0[ 5 ];
+	S[ 6 ] = g + H0[ 6 ];
+	S[ 7 ] = h + H0[ 7 ];
+
+	kw_rounds( S, sha256_pad64_kw );
+
+	for ( size_t i = 0; i < 8; i++ )
+	{
+		W[ i ] = S[ i ];
+		W[ i + 8 ] = ( v16u32 ) _mm512_set1_epi32( ( int ) sha256_pad32_w[ i ] );
+	}
+
+	a = H0[ 0 ];
+	b = H0[ 1 ];
+	c = H0[ 2 ];
+	d = H0[ 3 ];
+	e = H0[ 4 ];
+	f = H0[ 5 ];
+	g = H0[ 6 ];
+	h = H0[ 7 ];
+
+	ROUNDS8(  0, KW_LOADED );
+	ROUNDS8(  8, KW_PAD32 );
+	ROUNDS8( 16, KW_NEXT );
+	ROUNDS8( 24, KW_NEXT );
+	ROUNDS8( 32, KW_NEXT );
+	ROUNDS8( 40, KW_NEXT );
+	ROUNDS8( 48, KW_NEXT );
+	ROUNDS8( 56, KW_NEXT );
+
+	S[ 0 ] = H0[ 0 ] + a;
+	S[ 1 ] = H0[ 1 ] + b;
+	S[ 2 ] = H0[ 2 ] + c;
+	S[ 3 ] = H0[ 3 ] + d;
+	S[ 4 ] = H0[ 4 ] + e;
+	S[ 5 ] = H0[ 5 ] + f;
+	S[ 6 ] = H0[ 6 ] + g;
+	S[ 7 ] = H0[ 7 ] + h;
+
+	for ( size_t i = 0; i < 8; i++ )
+		_mm512_storeu_si512( ( void * ) &state[ i * 16 ], ( __m512i ) S[ i ] );
+
+	for ( size_t l = 0; l < 16; l++ )
+	{
+		for ( size_t i = 0; i < 8; i++ )
+			STORE32_BE( &out[ l * 32 + i * 4 ], state[ i * 16 + l ] );
+	}
+}
+
+/*
+ * Hash chains, see sha256_chain.c. The digest words stay in registers as the
+ * next block's first eight schedule words.
+ */
+
+AVX512_TARGET
+void sha256_chain_avx512( uint8_t *md, uint64_t iter )
+{
+	uint32_t state[ 8 * 16 ];
+	v16u32 W[ 16 ];
+	v16u32 a, b, c, d, e, f, g, h;
+	v16u32 H0[ 8 ], D[ 8 ], PAD[ 8 ];
+
+	for ( size_t i = 0; i < 8; i++ )
+	{
+		H0[ i ] = ( v16u32 ) _mm512_set1_epi32( ( int ) sha256_H0[ i ] );
+		PAD[ i ] = ( v16u32 ) _mm512_set1_epi32( ( int ) sha256_pad32_w[ i ] );
+	}
+
+	/*
+	 * load_words reads whole blocks, the values are only half of one.
+	 */
+
+	for ( size_t l = 0; l < 16; l++ )
+	{
+		for ( size_t i = 0; i < 8; i++ )
+			state[ i * 16 + l ] = LOAD32_BE( &md[ l * 32 + i * 4 ] );
+	}
+
+	for ( size_t i = 0; i < 8; i++ )
+		D[ i ] = ( v16u32 ) _mm512_loadu_si512( ( const void * ) &state[ i * 16 ] );
+
+	while ( iter-- > 0 )
+	{
+		for ( size_t i = 0; i < 8; i++ )
+		{
+			W[ i ] = D[ i ];
+			W[ i + 8 ] = PAD[ i ];
+		}
+
+		a = H0[ 0 ];
+		b = H0[ 1 ];
+		c = H0[ 2 ];
+		d = H0[ 3 ];
+		e = H0[ 4 ];
+		f = H0[ 5 ];
+		g = H0[ 6 ];
+		h = H0[ 7 ];
+
+		ROUNDS8(  0, KW_LOADED );
+		ROUNDS8(  8, KW_PAD32 );
+		ROUNDS8( 16, KW_NEXT );
+		ROUNDS8( 24, KW_NEXT );
+		ROUNDS8( 32, KW_NEXT );
+		ROUNDS8( 40, KW_NEXT );
+		ROUNDS8( 48, KW_NEXT );
+		ROUNDS8( 56, KW_NEXT );
+
+		D[ 0 ] = H0[ 0 ] + a;
+		D[ 1 ] = H0[ 1 ] + b;
+		D[ 2 ] = H0[ 2 ] + c;
+		D[ 3 ] = H0[ 3 ] + d;
+		D[ 4 ] = H0[ 4 ] + e;
+		D[ 5 ] = H0[ 5 ] + f;
+		D[ 6 ] = H0[ 6 ] + g;
+		D[ 7 ] = H0[ 7 ] + h;
+	}
+
+	for ( size_t i = 0; i < 8; i++ )
+		_mm512_storeu_si512( ( void * ) &state[ i * 16 ], ( __m512i ) D[ i ] );
+
+	for ( size_t l = 0; l < 16; l++ )
+	{
+		for ( size_t i = 0; i < 8; i++ )
+			STORE32_BE( &md[ l * 32 + i * 4 ], state[ i * 16 + l ] );
+	}
+}
+
+#endif
@@ -0,0 +1,228 @@
+#include <string.h>
+
+#include "sha256_mb.h"
+#include "sha256_internal.h"
+
+/*
+ * Job manager on top of the multi-buffer kernels.
+ *
+ * A submit turns its piece of the message into at most three runs of whole
+ * blocks: the block completed from what was buffered before, the whole blocks
+ * read straight from the caller's data, and for the last piece the padded
+ * tail. Whatever is left over stays in ctx.buf for the next submit. Like the
+ * batch driver the kernel is then called for as many blocks as the shortest
+ * run has left, and a job is done once its last run is.
+ */
+
+/**
+ * job_prepare - split the next piece of a message into runs of blocks
+ * @job: job being submitted
+ */
+
+static void job_prepare( struct sha256_job *job )
+{
+	struct sha256_ctx *ctx = &job->ctx;
+	const uint8_t *data = job->data;
+	size_t len = job->len;
+	size_t buf_len = ctx->len % 64;
+
+	job->runs = 0;
+	ctx->len += len;
+
+	if ( buf_len > 0 )
+	{
+		size_t n = MIN( 64 - buf_len, len );
+
+		memcpy( &ctx->buf[ buf_len ], data, n );
+		buf_len += n;
+		data += n;
+		len -= n;
+
+		if ( buf_len < 64 )
+		{
+			data = ctx->buf;
+			len = buf_len;
+		}
+		else
+		{
+			memcpy( job->block, ctx->buf, 64 );
+			job->run[ job->runs ].p = job->block;
+			job->run[ job->runs ].blocks = 1;
+			job->runs++;
+		}
+	}
+
+	if ( len >= 64 )
+	{
+		job->run[ job->runs ].p = data;
+		job->run[ job->runs ].blocks = len / 64;
+		job->runs++;
+		data += len & ~( size_t ) 63;
+		len %= 64;
+	}
+
+	if ( job->flags & SHA256_JOB_LAST )
+	{
+		job->run[ job->runs ].p = job->tail;
+		job->run[ job->runs ].blocks = sha256_pad( job->tail, data, len, ctx->len );
+		job->runs++;
+	}
+	else if ( data != ctx->buf )
+	{
+		memcpy( ctx->buf, data, len );
+	}
+}
+
+/**
+ * job_done - take a finished job out of its lane
+ * @mgr: manager
+ * @l: lane the job is in
+ *
+ * Return: the job
+ */
+
+static struct sha256_job *job_done( struct sha256_mgr *mgr, unsigned l )
+{
+	struct sha256_job *job = mgr->lane[ l ];
+
+	for ( size_t i = 0; i < 8; i++ )
+		job->ctx.H[ i ] = mgr->state[ i * mgr->lanes + l ];
+
+	if ( job->flags & SHA256_JOB_LAST && job->md != NULL )
+	{
+		for ( size_t i = 0; i < 8; i++ )
+			STORE32_BE( &job->md[ i * 4 ], job->ctx.H[ i ] );
+	}
+
+	job->status = SHA256_JOB_COMPLETE;
+	mgr->lane[ l ] = NULL;
+	mgr->busy--;
+
+	return job;
+}
+
+/**
+ * take_done - find a lane whose job has run out of blocks
+ * @mgr: manager
+ *
+ * Return: the finished job, or NULL if every job still has blocks left
+ */
+
+static struct sha256_job *take_done( struct sha256_mgr *mgr )
+{
+	for ( unsigned l = 0; l < mgr->lanes; l++ )
+	{
+		if ( mgr->lane[ l ] != NULL && mgr->lane[ l ]->runs == 0 )
+			return job_done( mgr, l );
+	}
+
+	return NULL;
+}
+
+/**
+ * run - hash until at least one job has run out of blocks
+ * @mgr: manager with at least one job in it
+ *
+ * Return: the finished job
+ */
+
+static struct sha256_job *run( struct sha256_mgr *mgr )
+{
+	const uint8_t *ptr[ SHA256_MGR_MAX_LANES ];
+	struct sha256_job *job;
+
+	while ( ( job = take_done( mgr ) ) == NULL )
+	{
+		size_t step = ( size_t ) -1;
+		const uint8_t *any = NULL;
+
+		for ( unsigned l = 0; l < mgr->lanes; l++ )
+		{
+			if ( mgr->lane[ l ] == NULL )
+				continue;
+
+			step = MIN( step, mgr->lane[ l ]->run[ 0 ].blocks );
+			any = mgr->lane[ l ]->run[ 0 ].p;
+		}
+
+		for ( unsigned l = 0; l < mgr->lanes; l++ )
+			ptr[ l ] = mgr->lane[ l ] != NULL ? mgr->lane[ l ]->run[ 0 ].p : any;
+
+		mgr->kernel->blocks( mgr->state, ptr, step );
+
+		for ( unsigned l = 0; l < mgr->lanes; l++ )
+		{
+			struct sha256_job *j = mgr->lane[ l ];
+
+			if ( j == NULL )
+				continue;
+
+			j->run[ 0 ].p += step * 64;
+			j->run[ 0 ].blocks -= step;
+
+			if ( j->run[ 0 ].blocks == 0 )
+			{
+				j->runs--;
+				memmove( &j->run[ 0 ], &j->run[ 1 ], j->runs * sizeof( j->run[ 0 ] ) );
+			}
+		}
+	}
+
+	return job;
+}
+
+void sha256_mgr_init( struct sha256_mgr *mgr )
+{
+	mgr->kernel = sha256_mb;
+	mgr->lanes = sha256_mb->lanes;
+	mgr->busy = 0;
+
+	for ( unsigned l = 0; l < SHA256_MGR_MAX_LANES; l++ )
+		mgr->lane[ l ] = NULL;
+}
+
+struct sha256_job *sha256_mgr_submit( struct sha256_mgr *mgr, struct sha256_job *job )
+{
+	struct sha256_job *done;
+	unsigned l = 0;
+
+	if ( job->flags & SHA256_JOB_FIRST )
+		sha256_init( &job->ctx );
+
+	job_prepare( job );
+
+	if ( job->runs == 0 )
+	{
+		job->status = SHA256_JOB_COMPLETE;
+		return job;
+	}
+
+	/*
+	 * There is always a free lane here, a submit that fills the last one
+	 * doesn't return before it has emptied one again.
+	 */
+
+	while ( mgr->lane[ l ] != NULL )
+		l++;
+
+	for ( size_t i = 0; i < 8; i++ )
+		mgr->state[ i * mgr->lanes + l ] = job->ctx.H[ i ];
+
+	job->status = SHA256_JOB_PROCESSING;
+	mgr->lane[ l ] = job;
+	mgr->busy++;
+
+	done = take_done( mgr );
+	if ( done == NULL && mgr->busy == mgr->lanes )
+		done = run( mgr );
+
+	return done;
+}
+
+struct sha256_job *sha256_mgr_flush( struct sha256_mgr *mgr )
+{
+	if ( mgr->busy == 0 )
+		return NULL;
+
+	return run( mgr );
+}
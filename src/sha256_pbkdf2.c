@@ -0,0 +1,228 @@
+#include <string.h>
+
+#include "sha256_pbkdf2.h"
+#include "sha256_hmac.h"
+#include "sha256_internal.h"
+
+/*
+ * PBKDF2, see sha256_pbkdf2.h.
+ *
+ * T_i = U_1 ^ U_2 ^ ... ^ U_c
+ * U_1 = HMAC( P, S || INT( i ) )
+ * U_j = HMAC( P, U_j-1 )
+ *
+ * U_1 has a message of any length and is done with the streaming HMAC. From
+ * then on both the inner and the outer hash are of a 32 byte message after
+ * one block of key, so each is a single block, the previous digest followed
+ * by padding for a 96 byte message. Each lane keeps that block with its
+ * padding filled in once, an iteration only writes the digest into it.
+ *
+ * The key midstates and every U and T are as good as the password, so they
+ * are wiped once they're no longer needed.
+ */
+
+/*
+ * A lone chain is better off in one lane than taking up half of a two lane
+ * kernel.
+ */
+
+static const struct sha256_mb_kernel single = { "serial", 1, sha256_mb_serial, sha256d64_scalar, sha256_chain_scalar, sha256_kw_block_scalar };
+
+struct chain
+{
+	uint32_t inner[ 8 ];
+	uint32_t outer[ 8 ];
+	uint32_t U[ 8 ];
+	uint32_t T[ 8 ];
+	uint32_t left;
+	uint8_t *out;
+	size_t out_len;
+};
+
+/*
+ * Hands out the chains of a batch one at a time, in order.
+ */
+
+struct chains
+{
+	const struct sha256_pbkdf2_req *req;
+	size_t n;
+	size_t r;
+	uint32_t i;
+	struct sha256_hmac_key key;
+};
+
+/**
+ * chain_done - write out a finished chain
+ * @c: chain with no iterations left
+ */
+
+static void chain_done( const struct chain *c )
+{
+	uint8_t T[ SHA256_DIGEST_SIZE ];
+
+	for ( size_t w = 0; w < 8; w++ )
+		STORE32_BE( &T[ w * 4 ], c->T[ w ] );
+
+	memcpy( c->out, T, c->out_len );
+	sha256_wipe( T, sizeof( T ) );
+}
+
+/**
+ * chain_next - start the next chain, doing its first iteration
+ * @g: chains of the batch
+ * @c: output chain
+ *
+ * Chains with a single iteration are finished right away and skipped.
+ *
+ * Return: 1 if a chain was started, 0 if there are none left
+ */
+
+static int chain_next( struct chains *g, struct chain *c )
+{
+	for ( ;; )
+	{
+		const struct sha256_pbkdf2_req *req;
+		struct sha256_hmac_ctx h;
+		uint8_t U[ SHA256_DIGEST_SIZE ];
+		uint8_t i_be[ 4 ];
+		size_t off;
+
+		if ( g->r == g->n )
+			return 0;
+
+		req = &g->req[ g->r ];
+		off = ( size_t ) g->i * SHA256_DIGEST_SIZE;
+
+		if ( off >= req->out_len )
+		{
+			g->r++;
+			g->i = 0;
+			continue;
+		}
+
+		if ( g->i == 0 )
+			sha256_hmac_key_init( &g->key, req->pw, req->pw_len );
+
+		g->i++;
+		STORE32_BE( i_be, g->i );
+
+		sha256_hmac_init( &h, &g->key );
+		sha256_hmac_update( &h, req->salt, req->salt_len );
+		sha256_hmac_update( &h, i_be, sizeof( i_be ) );
+		sha256_hmac_final( &h, U );
+
+		for ( size_t w = 0; w < 8; w++ )
+			c->U[ w ] = c->T[ w ] = LOAD32_BE( &U[ w * 4 ] );
+
+		sha256_wipe( U, sizeof( U ) );
+		sha256_wipe( &h, sizeof( h ) );
+
+		memcpy( c->inner, g->key.inner.H, sizeof( c->inner ) );
+		memcpy( c->outer, g->key.outer.H, sizeof( c->outer ) );
+		c->left = req->iter > 1 ? req->iter - 1 : 0;
+		c->out = &req->out[ off ];
+		c->out_len = MIN( req->out_len - off, SHA256_DIGEST_SIZE );
+
+		if ( c->left > 0 )
+			return 1;
+
+		chain_done( c );
+	}
+}
+
+void sha256_pbkdf2_batch( const struct sha256_pbkdf2_req *req, size_t n )
+{
+	const struct sha256_mb_kernel *k;
+	struct chains g = { .req = req, .n = n };
+	struct chain lane[ SHA256_MB_MAX_LANES ];
+	uint8_t blk[ SHA256_MB_MAX_LANES ][ SHA256_BLOCK_SIZE ];
+	const uint8_t *ptr[ SHA256_MB_MAX_LANES ];
+	uint32_t state[ 8 * SHA256_MB_MAX_LANES ];
+	size_t chains = 0;
+	unsigned lanes, busy = 0;
+
+	for ( size_t r = 0; r < n; r++ )
+		chains += ( req[ r ].out_len + SHA256_DIGEST_SIZE - 1 ) / SHA256_DIGEST_SIZE;
+
+	k = chains > 1 ? sha256_mb_pick( chains ) : &single;
+	lanes = k->lanes;
+	memset( lane, 0, sizeof( lane ) );
+
+	for ( unsigned l = 0; l < lanes; l++ )
+	{
+		memset( blk[ l ], 0, SHA256_BLOCK_SIZE );
+		blk[ l ][ SHA256_DIGEST_SIZE ] = 0x80;
+		STORE32_BE( &blk[ l ][ SHA256_BLOCK_SIZE - 4 ], ( SHA256_BLOCK_SIZE + SHA256_DIGEST_SIZE ) * 8 );
+		ptr[ l ] = blk[ l ];
+
+		if ( chain_next( &g, &lane[ l ] ) )
+			busy++;
+	}
+
+	while ( busy > 0 )
+	{
+		for ( unsigned l = 0; l < lanes; l++ )
+		{
+			for ( size_t w = 0; w < 8; w++ )
+			{
+				STORE32_BE( &blk[ l ][ w * 4 ], lane[ l ].U[ w ] );
+				state[ w * lanes + l ] = lane[ l ].inner[ w ];
+			}
+		}
+
+		k->blocks( state, ptr, 1 );
+
+		for ( unsigned l = 0; l < lanes; l++ )
+		{
+			for ( size_t w = 0; w < 8; w++ )
+			{
+				STORE32_BE( &blk[ l ][ w * 4 ], state[ w * lanes + l ] );
+				state[ w * lanes + l ] = lane[ l ].outer[ w ];
+			}
+		}
+
+		k->blocks( state, ptr, 1 );
+
+		for ( unsigned l = 0; l < lanes; l++ )
+		{
+			struct chain *c = &lane[ l ];
+
+			if ( c->left == 0 )
+				continue;
+
+			for ( size_t w = 0; w < 8; w++ )
+			{
+				c->U[ w ] = state[ w * lanes + l ];
+				c->T[ w ] ^= c->U[ w ];
+			}
+
+			if ( --c->left > 0 )
+				continue;
+
+			chain_done( c );
+			if ( !chain_next( &g, c ) )
+				busy--;
+		}
+	}
+
+	sha256_wipe( &g.key, sizeof( g.key ) );
+	sha256_wipe( lane, sizeof( lane ) );
+	sha256_wipe( blk, sizeof( blk ) );
+	sha256_wipe( state, sizeof( state ) );
+}
+
+void sha256_pbkdf2( const uint8_t *pw, size_t pw_len, const uint8_t *salt, size_t salt_len, uint32_t iter, uint8_t *out, size_t out_len )
+{
+	struct sha256_pbkdf2_req req = {
+		.pw = pw,
+		.pw_len = pw_len,
+		.salt = salt,
+		.salt_len = salt_len,
+		.iter = iter,
+		.out = out,
+		.out_len = out_len
+	};
+
+	sha256_pbkdf2_batch( &req, 1 );
+}
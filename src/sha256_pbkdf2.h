@@ -0,0 +1,58 @@
+#ifndef SHA256_PBKDF2_H
+#define SHA256_PBKDF2_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256.h"
+
+/*
+ * PBKDF2-HMAC-SHA256, RFC 8018.
+ *
+ * Every 32 byte block of derived key is an independent chain of HMACs, each
+ * one the mac of the 32 byte output of the previous one. So apart from the
+ * first HMAC of each chain every iteration is exactly two compressions of a
+ * block whose padding never changes, one from the key's inner midstate and
+ * one from its outer midstate. The chains, whether they are blocks of one
+ * long key or keys of separate derivations, run side by side in the lanes of
+ * the multi-buffer kernel.
+ */
+
+struct sha256_pbkdf2_req
+{
+	const uint8_t *pw;
+	size_t pw_len;
+	const uint8_t *salt;
+	size_t salt_len;
+	uint32_t iter;
+	uint8_t *out;
+	size_t out_len;
+};
+
+/**
+ * sha256_pbkdf2 - derive a key from a password
+ * @pw: the password
+ * @pw_len: length of pw in number of bytes
+ * @salt: the salt
+ * @salt_len: length of salt in number of bytes
+ * @iter: iteration count, at least 1
+ * @out: output, the derived key
+ * @out_len: length of the derived key in number of bytes
+ */
+
+void sha256_pbkdf2( const uint8_t *pw, size_t pw_len, const uint8_t *salt, size_t salt_len, uint32_t iter, uint8_t *out, size_t out_len );
+
+/**
+ * sha256_pbkdf2_batch - run many derivations at once
+ * @req: array of n derivations, each with its own password, salt, iteration
+ *       count and output
+ * @n: number of derivations
+ *
+ * Gives the same keys as calling sha256_pbkdf2 for each one, but fills the
+ * SIMD lanes with chains from all of them. Iteration counts may differ, a lane
+ * whose chain is done moves on to the next one.
+ */
+
+void sha256_pbkdf2_batch( const struct sha256_pbkdf2_req *req, size_t n );
+
+#endif
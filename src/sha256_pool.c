@@ -0,0 +1,559 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sha256_pool.h"
+#include "sha256_internal.h"
+
+/*
+ * Each deque is the fixed size array version of the Chase-Lev deque, with
+ * the memory orderings from "Correct and Efficient Work-Stealing for Weak
+ * Memory Models" (Le, Pop, Cohen, Zappa Nardelli, 2013). The owner pushes and
+ * pops at the bottom, thieves take from the top. When a deque is full the
+ * owner simply runs the task itself.
+ *
+ * Idle threads sleep on a condition variable. Every time there may be new
+ * work, or a group just finished, the epoch counter goes up. A thread only
+ * goes to sleep if the epoch is still what it was before it last looked for
+ * work, and whoever bumps the epoch only takes the lock to wake sleepers when
+ * there are any.
+ *
+ * Idle workers and threads waiting on a group sleep on separate condition
+ * variables. A new task wakes a single sleeper, a worker if there is one,
+ * since only one thread can take it. A finished group has to reach the
+ * thread waiting on it, and there is no telling which of the waiters that
+ * is, so it wakes them all. The workers are only woken all at once to shut
+ * down.
+ */
+
+#define DEQUE_SIZE 1024
+
+/*
+ * Most threads the default pool takes from SHA256_THREADS.
+ */
+
+#define THREADS_MAX 1024
+
+struct deque
+{
+	int64_t top __attribute__( ( aligned( 64 ) ) );
+	int64_t bottom __attribute__( ( aligned( 64 ) ) );
+	struct sha256_task *slot[ DEQUE_SIZE ];
+};
+
+struct worker
+{
+	struct sha256_pool *pool;
+	pthread_t tid;
+	uint32_t rng;
+	struct deque q;
+};
+
+struct sha256_pool
+{
+	unsigned threads;
+	struct worker *worker;
+
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+	struct sha256_task *inject_head;
+	struct sha256_task *inject_tail;
+	unsigned long epoch;
+	unsigned sleepers;
+	unsigned waiters;
+	int stop;
+};
+
+static __thread struct worker *self;
+
+/**
+ * deque_push - add a task at the bottom, only called by the owner
+ * @q: deque
+ * @task: task
+ *
+ * Return: 0 on success, -1 if the deque is full
+ */
+
+static int deque_push( struct deque *q, struct sha256_task *task )
+{
+	int64_t b = __atomic_load_n( &q->bottom, __ATOMIC_RELAXED );
+	int64_t t = __atomic_load_n( &q->top, __ATOMIC_ACQUIRE );
+
+	if ( b - t >= DEQUE_SIZE )
+		return -1;
+
+	__atomic_store_n( &q->slot[ b % DEQUE_SIZE ], task, __ATOMIC_RELAXED );
+	__atomic_store_n( &q->bottom, b + 1, __ATOMIC_RELEASE );
+
+	return 0;
+}
+
+/**
+ * deque_pop - take the task at the bottom, only called by the owner
+ * @q: deque
+ *
+ * Return: the most recently pushed task, or NULL if the deque is empty
+ */
+
+static struct sha256_task *deque_pop( struct deque *q )
+{
+	int64_t b = __atomic_load_n( &q->bottom, __ATOMIC_RELAXED ) - 1;
+	int64_t t;
+	struct sha256_task *task = NULL;
+
+	__atomic_store_n( &q->bottom, b, __ATOMIC_RELAXED );
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+	t = __atomic_load_n( &q->top, __ATOMIC_RELAXED );
+
+	if ( t <= b )
+	{
+		task = __atomic_load_n( &q->slot[ b % DEQUE_SIZE ], __ATOMIC_RELAXED );
+		if ( t != b )
+			return task;
+
+		/*
+		 * Last task, race the thieves for it.
+		 */
+
+		if ( !__atomic_compare_exchange_n( &q->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED ) )
+			task = NULL;
+	}
+
+	__atomic_store_n( &q->bottom, b + 1, __ATOMIC_RELAXED );
+
+	return task;
+}
+
+/**
+ * deque_steal - take the task at the top, called by any other thread
+ * @q: deque
+ *
+ * Return: the oldest task, or NULL if the deque is empty or another thread
+ * got there first
+ */
+
+static struct sha256_task *deque_steal( struct deque *q )
+{
+	int64_t t = __atomic_load_n( &q->top, __ATOMIC_ACQUIRE );
+	int64_t b;
+	struct sha256_task *task;
+
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+	b = __atomic_load_n( &q->bottom, __ATOMIC_ACQUIRE );
+
+	if ( t >= b )
+		return NULL;
+
+	task = __atomic_load_n( &q->slot[ t % DEQUE_SIZE ], __ATOMIC_RELAXED );
+	if ( !__atomic_compare_exchange_n( &q->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED ) )
+		return NULL;
+
+	return task;
+}
+
+/**
+ * notify_work - wake one idle thread to take a new task
+ * @pool: pool
+ */
+
+static void notify_work( struct sha256_pool *pool )
+{
+	__atomic_add_fetch( &pool->epoch, 1, __ATOMIC_SEQ_CST );
+
+	if ( __atomic_load_n( &pool->sleepers, __ATOMIC_SEQ_CST ) == 0 && __atomic_load_n( &pool->waiters, __ATOMIC_SEQ_CST ) == 0 )
+		return;
+
+	pthread_mutex_lock( &pool->lock );
+
+	if ( pool->sleepers > 0 )
+		pthread_cond_signal( &pool->wake );
+	else if ( pool->waiters > 0 )
+		pthread_cond_signal( &pool->done );
+
+	pthread_mutex_unlock( &pool->lock );
+}
+
+/**
+ * notify_done - wake the threads waiting on groups after one finished
+ * @pool: pool
+ */
+
+static void notify_done( struct sha256_pool *pool )
+{
+	__atomic_add_fetch( &pool->epoch, 1, __ATOMIC_SEQ_CST );
+
+	if ( __atomic_load_n( &pool->waiters, __ATOMIC_SEQ_CST ) == 0 )
+		return;
+
+	pthread_mutex_lock( &pool->lock );
+	pthread_cond_broadcast( &pool->done );
+	pthread_mutex_unlock( &pool->lock );
+}
+
+/**
+ * idle - sleep until the epoch moves past seen
+ * @pool: pool
+ * @seen: epoch from before the last search for work
+ * @waiting: nonzero for a thread waiting on a group, zero for a worker
+ *
+ * Return: nonzero if the pool is being destroyed
+ */
+
+static int idle( struct sha256_pool *pool, unsigned long seen, int waiting )
+{
+	unsigned *count = waiting ? &pool->waiters : &pool->sleepers;
+	pthread_cond_t *cond = waiting ? &pool->done : &pool->wake;
+	int stop;
+
+	pthread_mutex_lock( &pool->lock );
+
+	__atomic_add_fetch( count, 1, __ATOMIC_SEQ_CST );
+	while ( !pool->stop && __atomic_load_n( &pool->epoch, __ATOMIC_SEQ_CST ) == seen )
+		pthread_cond_wait( cond, &pool->lock );
+	__atomic_sub_fetch( count, 1, __ATOMIC_SEQ_CST );
+
+	stop = pool->stop;
+	pthread_mutex_unlock( &pool->lock );
+
+	return stop;
+}
+
+/**
+ * find_work - take a task from anywhere in the pool
+ * @pool: pool
+ * @me: the calling worker, or NULL for a thread outside the pool
+ *
+ * Return: a task, or NULL if none was found
+ */
+
+static struct sha256_task *find_work( struct sha256_pool *pool, struct worker *me )
+{
+	struct sha256_task *task;
+	unsigned start;
+
+	if ( me != NULL && ( task = deque_pop( &me->q ) ) != NULL )
+		return task;
+
+	if ( __atomic_load_n( &pool->inject_head, __ATOMIC_RELAXED ) != NULL )
+	{
+		pthread_mutex_lock( &pool->lock );
+
+		task = pool->inject_head;
+		if ( task != NULL )
+		{
+			__atomic_store_n( &pool->inject_head, task->next, __ATOMIC_RELAXED );
+			if ( pool->inject_head == NULL )
+				pool->inject_tail = NULL;
+		}
+
+		pthread_mutex_unlock( &pool->lock );
+
+		if ( task != NULL )
+			return task;
+	}
+
+	if ( pool->threads == 0 )
+		return NULL;
+
+	/*
+	 * Start at a random victim so thieves don't all go after the same one.
+	 */
+
+	if ( me != NULL )
+	{
+		me->rng = me->rng * 1103515245 + 12345;
+		start = ( me->rng >> 16 ) % pool->threads;
+	}
+	else
+	{
+		start = 0;
+	}
+
+	for ( unsigned i = 0; i < pool->threads; i++ )
+	{
+		struct worker *w = &pool->worker[ ( start + i ) % pool->threads ];
+
+		if ( w != me && ( task = deque_steal( &w->q ) ) != NULL )
+			return task;
+	}
+
+	return NULL;
+}
+
+/**
+ * run_task - run a task and count it off its group
+ * @pool: pool
+ * @task: task
+ */
+
+static void run_task( struct sha256_pool *pool, struct sha256_task *task )
+{
+	/*
+	 * fn may reuse or free the task, so the group is read before calling it.
+	 */
+
+	struct sha256_group *group = task->group;
+
+	task->fn( task );
+
+	if ( group != NULL && __atomic_sub_fetch( &group->pending, 1, __ATOMIC_ACQ_REL ) == 0 )
+		notify_done( pool );
+}
+
+/**
+ * worker_main - run tasks until the pool is destroyed
+ * @arg: the worker
+ *
+ * Return: NULL
+ */
+
+static void *worker_main( void *arg )
+{
+	struct worker *me = arg;
+	struct sha256_pool *pool = me->pool;
+
+	self = me;
+
+	for ( ;; )
+	{
+		unsigned long seen = __atomic_load_n( &pool->epoch, __ATOMIC_SEQ_CST );
+		struct sha256_task *task = find_work( pool, me );
+
+		if ( task != NULL )
+			run_task( pool, task );
+		else if ( idle( pool, seen, 0 ) )
+			break;
+	}
+
+	return NULL;
+}
+
+/**
+ * pin_cpu - pick the cpu to pin a worker to
+ * @allowed: cpus the process may run on
+ * @count: number of cpus in allowed
+ * @i: index of the worker
+ *
+ * Workers go round the allowed cpus in order, so a process restricted to a
+ * few cpus doesn't pin its workers to cpus it can't use.
+ *
+ * Return: cpu number
+ */
+
+#if defined( __linux__ )
+static int pin_cpu( const cpu_set_t *allowed, unsigned count, unsigned i )
+{
+	i %= count;
+
+	for ( int cpu = 0; cpu < CPU_SETSIZE; cpu++ )
+	{
+		if ( CPU_ISSET( cpu, allowed ) && i-- == 0 )
+			return cpu;
+	}
+
+	return 0;
+}
+#endif
+
+struct sha256_pool *sha256_pool_create( unsigned threads, unsigned flags )
+{
+	struct sha256_pool *pool = calloc( 1, sizeof( *pool ) );
+	unsigned started = 0;
+#if defined( __linux__ )
+	cpu_set_t allowed;
+	unsigned allowed_count = 0;
+#endif
+
+	if ( pool == NULL )
+		return NULL;
+
+	/*
+	 * The deques are cache line aligned, which calloc doesn't guarantee.
+	 */
+
+	if ( threads > 0 )
+	{
+		if ( posix_memalign( ( void ** ) &pool->worker, 64, threads * sizeof( *pool->worker ) ) != 0 )
+		{
+			free( pool );
+			return NULL;
+		}
+
+		memset( pool->worker, 0, threads * sizeof( *pool->worker ) );
+	}
+
+#if defined( __linux__ )
+	if ( ( flags & SHA256_POOL_PIN ) && sched_getaffinity( 0, sizeof( allowed ), &allowed ) == 0 )
+		allowed_count = ( unsigned ) CPU_COUNT( &allowed );
+#endif
+
+	pthread_mutex_init( &pool->lock, NULL );
+	pthread_cond_init( &pool->wake, NULL );
+	pthread_cond_init( &pool->done, NULL );
+	pool->threads = threads;
+
+	for ( ; started < threads; started++ )
+	{
+		struct worker *w = &pool->worker[ started ];
+		pthread_attr_t attr;
+		int err;
+
+		w->pool = pool;
+		w->rng = started + 1;
+
+		pthread_attr_init( &attr );
+
+#if defined( __linux__ )
+		if ( allowed_count > 0 )
+		{
+			cpu_set_t set;
+
+			CPU_ZERO( &set );
+			CPU_SET( pin_cpu( &allowed, allowed_count, started ), &set );
+			pthread_attr_setaffinity_np( &attr, sizeof( set ), &set );
+		}
+#else
+		( void ) flags;
+#endif
+
+		err = pthread_create( &w->tid, &attr, worker_main, w );
+		pthread_attr_destroy( &attr );
+		if ( err != 0 )
+			break;
+	}
+
+	if ( started < threads )
+	{
+		pool->threads = started;
+		sha256_pool_destroy( pool );
+		return NULL;
+	}
+
+	return pool;
+}
+
+void sha256_pool_destroy( struct sha256_pool *pool )
+{
+	pthread_mutex_lock( &pool->lock );
+	pool->stop = 1;
+	pthread_cond_broadcast( &pool->wake );
+	pthread_cond_broadcast( &pool->done );
+	pthread_mutex_unlock( &pool->lock );
+
+	for ( unsigned i = 0; i < pool->threads; i++ )
+		pthread_join( pool->worker[ i ].tid, NULL );
+
+	pthread_cond_destroy( &pool->wake );
+	pthread_cond_destroy( &pool->done );
+	pthread_mutex_destroy( &pool->lock );
+	free( pool->worker );
+	free( pool );
+}
+
+static struct sha256_pool *default_pool;
+static pthread_once_t default_once = PTHREAD_ONCE_INIT;
+
+/**
+ * env_threads - read the thread count from SHA256_THREADS
+ *
+ * Return: the count, or 0 if the variable isn't set or isn't a number from 1
+ * to THREADS_MAX
+ */
+
+static long env_threads( void )
+{
+	const char *env = getenv( "SHA256_THREADS" );
+	char *end;
+	long n;
+
+	if ( env == NULL )
+		return 0;
+
+	errno = 0;
+	n = strtol( env, &end, 10 );
+
+	if ( errno != 0 || end == env || *end != '\0' || n < 1 || n > THREADS_MAX )
+		return 0;
+
+	return n;
+}
+
+static void default_init( void )
+{
+	long n = env_threads();
+
+	if ( n == 0 )
+		n = sysconf( _SC_NPROCESSORS_ONLN );
+
+	default_pool = sha256_pool_create( n > 1 ? ( unsigned ) n - 1 : 0, 0 );
+}
+
+struct sha256_pool *sha256_pool_default( void )
+{
+	pthread_once( &default_once, default_init );
+
+	return default_pool;
+}
+
+unsigned sha256_pool_threads( const struct sha256_pool *pool )
+{
+	return pool->threads;
+}
+
+void sha256_pool_submit( struct sha256_pool *pool, struct sha256_task *task )
+{
+	if ( task->group != NULL )
+		__atomic_add_fetch( &task->group->pending, 1, __ATOMIC_RELAXED );
+
+	if ( self != NULL && self->pool == pool )
+	{
+		if ( deque_push( &self->q, task ) != 0 )
+		{
+			run_task( pool, task );
+			return;
+		}
+	}
+	else
+	{
+		task->next = NULL;
+
+		pthread_mutex_lock( &pool->lock );
+
+		if ( pool->inject_tail != NULL )
+			pool->inject_tail->next = task;
+		else
+			__atomic_store_n( &pool->inject_head, task, __ATOMIC_RELAXED );
+		pool->inject_tail = task;
+
+		pthread_mutex_unlock( &pool->lock );
+	}
+
+	notify_work( pool );
+}
+
+void sha256_pool_wait( struct sha256_pool *pool, struct sha256_group *group )
+{
+	struct worker *me = self != NULL && self->pool == pool ? self : NULL;
+
+	for ( ;; )
+	{
+		unsigned long seen = __atomic_load_n( &pool->epoch, __ATOMIC_SEQ_CST );
+		struct sha256_task *task;
+
+		if ( __atomic_load_n( &group->pending, __ATOMIC_ACQUIRE ) == 0 )
+			return;
+
+		task = find_work( pool, me );
+		if ( task != NULL )
+			run_task( pool, task );
+		else
+			idle( pool, seen, 1 );
+	}
+}
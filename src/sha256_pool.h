@@ -0,0 +1,102 @@
+#ifndef SHA256_POOL_H
+#define SHA256_POOL_H
+
+#include <stddef.h>
+
+/*
+ * Work-stealing thread pool for the parallel hashing modes.
+ *
+ * Every worker thread has its own deque of tasks. A worker pushes and pops at
+ * one end of its deque and idle workers steal from the other end of somebody
+ * else's, so work spreads out without a shared queue everybody contends on.
+ * Tasks submitted from outside the pool go on a separate injection list that
+ * the workers also take from.
+ *
+ * Tasks are owned by the caller, usually embedded as the first member of a
+ * larger structure holding the task's arguments, so submitting never
+ * allocates. A group counts the tasks submitted with it that haven't finished
+ * yet, sha256_pool_wait runs tasks on the calling thread until the group's
+ * count drops to zero.
+ */
+
+struct sha256_pool;
+
+struct sha256_group
+{
+	unsigned long pending;
+};
+
+struct sha256_task
+{
+	void ( *fn )( struct sha256_task *task );
+	struct sha256_group *group;
+	struct sha256_task *next;
+};
+
+#define SHA256_POOL_PIN 1
+
+/**
+ * sha256_pool_create - start a pool of worker threads
+ * @threads: number of worker threads, may be 0
+ * @flags: SHA256_POOL_PIN to pin worker i to the i-th cpu the process may
+ *         run on
+ *
+ * A thread waiting on a group runs tasks as well, so a pool of n - 1 workers
+ * keeps n cpus busy while its owner waits. With 0 workers every task runs on
+ * the waiting thread.
+ *
+ * Return: the new pool, or NULL if it couldn't be created
+ */
+
+struct sha256_pool *sha256_pool_create( unsigned threads, unsigned flags );
+
+/**
+ * sha256_pool_destroy - stop the worker threads and free the pool
+ * @pool: pool with no tasks left in it
+ */
+
+void sha256_pool_destroy( struct sha256_pool *pool );
+
+/**
+ * sha256_pool_default - the pool shared by the library
+ *
+ * Created on first use with one worker less than there are cpus, or one less
+ * than the SHA256_THREADS environment variable when it is set to a number
+ * from 1 to 1024. Other values of SHA256_THREADS are ignored. Parallel
+ * functions that take a pool use this one when they are passed NULL, so they
+ * share the same threads instead of each starting their own.
+ *
+ * Return: the default pool, or NULL if it couldn't be created
+ */
+
+struct sha256_pool *sha256_pool_default( void );
+
+/**
+ * sha256_pool_threads - number of worker threads in a pool
+ * @pool: pool
+ *
+ * Return: number of workers, not counting threads that wait on a group
+ */
+
+unsigned sha256_pool_threads( const struct sha256_pool *pool );
+
+/**
+ * sha256_pool_submit - queue a task
+ * @pool: pool to run the task on
+ * @task: task with fn and group filled in, group may be NULL
+ *
+ * The task must stay valid until it has run. It may itself submit more tasks
+ * and wait on them.
+ */
+
+void sha256_pool_submit( struct sha256_pool *pool, struct sha256_task *task );
+
+/**
+ * sha256_pool_wait - run tasks until a group is done
+ * @pool: pool the group's tasks were submitted to
+ * @group: group to wait on, pending must have been 0 before its first submit
+ */
+
+void sha256_pool_wait( struct sha256_pool *pool, struct sha256_group *group );
+
+#endif
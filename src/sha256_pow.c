@@ -0,0 +1,271 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sha256_pow.h"
+#include "sha256_internal.h"
+
+/*
+ * Proof of work search, see sha256_pow.h.
+ *
+ * The range is handed out in chunks through a shared counter, like the leaves
+ * of a tree hash. Whoever finds a nonce lowers the shared best offset, and
+ * nobody takes a chunk, or starts a step of one, past it. Chunks are taken in
+ * order, so once the best offset is set everything below it has already been
+ * handed out and the search ends with the lowest nonce.
+ *
+ * Every thread's lane buffers are allocated by the caller before any search
+ * starts, so running out of memory is reported up front rather than leaving
+ * a helper to give up on its own.
+ *
+ * The message schedule isn't precomputed. The tries run on the multi-buffer
+ * kernels' block function, which expands the schedule inside the kernel, in
+ * hardware with SHA-NI. Using the nonce-independent words or a constant
+ * padding block would take a second entry point in every kernel, one that
+ * starts from precomputed rounds and K + W, for a saving that SHA-NI doesn't
+ * get at all.
+ */
+
+#define CHUNK 4096
+#define NONE UINT64_MAX
+
+struct pow
+{
+	const struct sha256_mb_kernel *k;
+	uint32_t mid[ 8 ];
+	const uint8_t *tail;
+	size_t blocks;
+	size_t pos;
+	unsigned bits;
+	uint64_t start;
+	uint64_t count;
+	uint64_t next;
+	uint64_t found;
+};
+
+/*
+ * Number of chunks in the range, without overflowing on huge counts.
+ */
+
+#define CHUNKS( count ) ( ( count ) / CHUNK + ( ( count ) % CHUNK != 0 ) )
+
+struct pow_task
+{
+	struct sha256_task task;
+	struct pow *p;
+	uint8_t *buf;
+};
+
+static void put_nonce( uint8_t *p, uint64_t nonce )
+{
+	STORE32_BE( &p[ 0 ], ( uint32_t ) ( nonce >> 32 ) );
+	STORE32_BE( &p[ 4 ], ( uint32_t ) nonce );
+}
+
+/**
+ * meets - check a lane's digest against the target
+ * @state: transposed state after the last block
+ * @lanes: number of lanes in state
+ * @l: lane to check
+ * @bits: number of leading zero bits needed
+ *
+ * Return: 1 if the digest starts with bits zero bits
+ */
+
+static int meets( const uint32_t *state, unsigned lanes, unsigned l, unsigned bits )
+{
+	for ( size_t w = 0; bits > 0; w++ )
+	{
+		uint32_t x = state[ w * lanes + l ];
+
+		if ( bits < 32 )
+			return x >> ( 32 - bits ) == 0;
+
+		if ( x != 0 )
+			return 0;
+
+		bits -= 32;
+	}
+
+	return 1;
+}
+
+static void lower_found( struct pow *p, uint64_t off )
+{
+	uint64_t cur = __atomic_load_n( &p->found, __ATOMIC_RELAXED );
+
+	while ( off < cur && !__atomic_compare_exchange_n( &p->found, &cur, off, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+		;
+}
+
+/**
+ * search - try chunks of nonces until there are none left worth trying
+ * @p: search
+ * @buf: room for a copy of the tail per lane
+ */
+
+static void search( struct pow *p, uint8_t *buf )
+{
+	unsigned lanes = p->k->lanes;
+	size_t tail_len = p->blocks * SHA256_BLOCK_SIZE;
+	const uint8_t *ptr[ SHA256_MB_MAX_LANES ];
+	uint32_t state[ 8 * SHA256_MB_MAX_LANES ];
+	uint64_t chunk;
+
+	for ( unsigned l = 0; l < lanes; l++ )
+	{
+		memcpy( &buf[ l * tail_len ], p->tail, tail_len );
+		ptr[ l ] = &buf[ l * tail_len ];
+	}
+
+	while ( ( chunk = __atomic_fetch_add( &p->next, 1, __ATOMIC_RELAXED ) ) < CHUNKS( p->count ) )
+	{
+		uint64_t first = chunk * CHUNK;
+		uint64_t end = MIN( first + CHUNK, p->count );
+
+		for ( uint64_t i = first; i < end && i < __atomic_load_n( &p->found, __ATOMIC_RELAXED ); i += lanes )
+		{
+			for ( unsigned l = 0; l < lanes; l++ )
+			{
+				put_nonce( &buf[ l * tail_len + p->pos ], p->start + i + l );
+
+				for ( size_t w = 0; w < 8; w++ )
+					state[ w * lanes + l ] = p->mid[ w ];
+			}
+
+			p->k->blocks( state, ptr, p->blocks );
+
+			for ( unsigned l = 0; l < lanes && i + l < end; l++ )
+			{
+				if ( meets( state, lanes, l, p->bits ) )
+				{
+					lower_found( p, i + l );
+					break;
+				}
+			}
+		}
+
+		if ( first + CHUNK >= __atomic_load_n( &p->found, __ATOMIC_RELAXED ) )
+			break;
+	}
+}
+
+static void pow_task( struct sha256_task *task )
+{
+	struct pow_task *t = ( struct pow_task * ) task;
+
+	search( t->p, t->buf );
+}
+
+int sha256_pow( const uint8_t *header, size_t len, size_t nonce_off, unsigned bits, uint64_t start, uint64_t count, struct sha256_pool *pool, uint64_t *nonce, uint8_t *md )
+{
+	size_t bulk = nonce_off & ~( size_t ) 63;
+	uint8_t *tail;
+	uint8_t *buf;
+	struct pow p;
+	struct pow_task *task;
+	struct sha256_group group = { 0 };
+	size_t helpers = 0;
+	size_t lane_size;
+
+	if ( nonce_off > len || len - nonce_off < SHA256_POW_NONCE_SIZE || bits > 256 )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	/*
+	 * The tail is everything from the block holding the nonce on, padded.
+	 */
+
+	tail = malloc( len - bulk + 2 * SHA256_BLOCK_SIZE );
+	if ( tail == NULL )
+		return -1;
+
+	memcpy( p.mid, sha256_H0, sizeof( sha256_H0 ) );
+	sha256_compress( p.mid, header, bulk / 64 );
+
+	p.blocks = ( len - bulk ) / 64;
+	memcpy( tail, &header[ bulk ], p.blocks * 64 );
+	p.blocks += sha256_pad( &tail[ p.blocks * 64 ], &header[ bulk + p.blocks * 64 ], ( len - bulk ) % 64, len );
+
+	p.k = sha256_mb_pick( ( size_t ) MIN( count, ( uint64_t ) SIZE_MAX ) );
+	p.tail = tail;
+	p.pos = nonce_off - bulk;
+	p.bits = bits;
+	p.start = start;
+	p.count = count;
+	p.next = 0;
+	p.found = NONE;
+
+	if ( pool == NULL )
+		pool = sha256_pool_default();
+
+	if ( pool != NULL )
+		helpers = MIN( sha256_pool_threads( pool ), CHUNKS( count ) - ( count > 0 ) );
+
+	/*
+	 * The last task is the calling thread's own and never submitted.
+	 */
+
+	lane_size = p.k->lanes * p.blocks * SHA256_BLOCK_SIZE;
+	task = malloc( ( helpers + 1 ) * sizeof( *task ) );
+	buf = malloc( ( helpers + 1 ) * lane_size );
+
+	if ( task == NULL || buf == NULL )
+	{
+		free( task );
+		free( buf );
+		free( tail );
+		errno = ENOMEM;
+		return -1;
+	}
+
+	for ( size_t i = 0; i <= helpers; i++ )
+	{
+		task[ i ].task.fn = pow_task;
+		task[ i ].task.group = &group;
+		task[ i ].p = &p;
+		task[ i ].buf = &buf[ i * lane_size ];
+
+		if ( i < helpers )
+			sha256_pool_submit( pool, &task[ i ].task );
+	}
+
+	search( &p, task[ helpers ].buf );
+
+	if ( helpers > 0 )
+		sha256_pool_wait( pool, &group );
+
+	free( task );
+	free( buf );
+
+	if ( p.found != NONE )
+	{
+		struct sha256_ctx ctx;
+		struct sha256_midstate ms;
+
+		*nonce = start + p.found;
+
+		if ( md != NULL )
+		{
+			put_nonce( &tail[ p.pos ], *nonce );
+			memcpy( ms.H, p.mid, sizeof( ms.H ) );
+			ms.len = bulk;
+			sha256_import( &ctx, &ms );
+			sha256_update( &ctx, tail, len - bulk );
+			sha256_final( &ctx, md );
+		}
+
+	}
+
+	free( tail );
+
+	if ( p.found == NONE )
+	{
+		errno = ENOENT;
+		return -1;
+	}
+
+	return 0;
+}
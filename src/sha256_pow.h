@@ -0,0 +1,46 @@
+#ifndef SHA256_POW_H
+#define SHA256_POW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256.h"
+#include "sha256_pool.h"
+
+/*
+ * Hashcash style proof of work. Find a nonce that, written into a fixed
+ * header, gives a digest starting with a given number of zero bits.
+ *
+ * Every block before the one holding the nonce is the same for every try, so
+ * it is hashed once and each try starts from the midstate after it. The rest
+ * of the header and its padding is laid out once per lane, a try only writes
+ * its nonce in. Tries run in the lanes of the multi-buffer kernel, on every
+ * thread of a pool.
+ */
+
+#define SHA256_POW_NONCE_SIZE 8
+
+/**
+ * sha256_pow - search for a nonce that meets a difficulty target
+ * @header: the message, with room for the nonce
+ * @len: length of header in number of bytes
+ * @nonce_off: offset of the nonce in header, stored as 8 bytes big endian
+ * @bits: number of leading zero bits the digest needs, at most 256
+ * @start: first nonce to try
+ * @count: number of nonces to try, going up from start
+ * @pool: pool to search on, NULL for sha256_pool_default
+ * @nonce: output, the nonce found
+ * @md: output digest of the header with that nonce, may be NULL
+ *
+ * The bytes of header at nonce_off are ignored. When more than one nonce in
+ * the range meets the target the lowest one is returned, so the result
+ * doesn't depend on how the search was spread over threads. Threads stop as
+ * soon as there's nothing lower left to try.
+ *
+ * Return: 0 if a nonce was found, -1 with errno set otherwise, ENOENT if no
+ * nonce in the range meets the target and ENOMEM if memory ran out
+ */
+
+int sha256_pow( const uint8_t *header, size_t len, size_t nonce_off, unsigned bits, uint64_t start, uint64_t count, struct sha256_pool *pool, uint64_t *nonce, uint8_t *md );
+
+#endif
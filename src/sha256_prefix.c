@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "sha256_prefix.h"
+#include "sha256_internal.h"
+
+/*
+ * Prefix cache, see sha256_prefix.h.
+ *
+ * Entries live in one array. They are found through a hash table of chained
+ * buckets and ordered by a doubly linked list, most recently used first, so
+ * a lookup, a hit and an eviction are all constant time. Hashing a missing
+ * prefix is done outside the lock.
+ */
+
+struct entry
+{
+	uint64_t key;
+	struct sha256_midstate ms;
+	struct entry *chain;
+	struct entry *prev;
+	struct entry *next;
+};
+
+struct sha256_prefix_cache
+{
+	pthread_mutex_t lock;
+	size_t entries;
+	size_t used;
+	size_t mask;
+	struct entry *head;
+	struct entry *tail;
+	struct entry **bucket;
+	struct entry *entry;
+};
+
+static struct entry **bucket_of( struct sha256_prefix_cache *c, uint64_t key, uint64_t len )
+{
+	uint64_t h = ( key ^ len ) * 0x9e3779b97f4a7c15ULL;
+
+	return &c->bucket[ ( h >> 32 ) & c->mask ];
+}
+
+static void lru_unlink( struct sha256_prefix_cache *c, struct entry *e )
+{
+	if ( e->prev != NULL )
+		e->prev->next = e->next;
+	else
+		c->head = e->next;
+
+	if ( e->next != NULL )
+		e->next->prev = e->prev;
+	else
+		c->tail = e->prev;
+}
+
+static void lru_push( struct sha256_prefix_cache *c, struct entry *e )
+{
+	e->prev = NULL;
+	e->next = c->head;
+
+	if ( c->head != NULL )
+		c->head->prev = e;
+	else
+		c->tail = e;
+
+	c->head = e;
+}
+
+/**
+ * lookup - find a prefix and mark it as just used
+ * @c: cache, locked
+ * @key: prefix key
+ * @len: length of the prefix's whole blocks
+ *
+ * Return: the entry, or NULL if the prefix isn't cached
+ */
+
+static struct entry *lookup( struct sha256_prefix_cache *c, uint64_t key, uint64_t len )
+{
+	struct entry *e = *bucket_of( c, key, len );
+
+	while ( e != NULL && ( e->key != key || e->ms.len != len ) )
+		e = e->chain;
+
+	if ( e != NULL && e != c->head )
+	{
+		lru_unlink( c, e );
+		lru_push( c, e );
+	}
+
+	return e;
+}
+
+/**
+ * insert - add a prefix, dropping the least recently used one if full
+ * @c: cache, locked
+ * @key: prefix key
+ * @ms: state after the prefix's whole blocks
+ */
+
+static void insert( struct sha256_prefix_cache *c, uint64_t key, const struct sha256_midstate *ms )
+{
+	struct entry *e;
+	struct entry **p;
+
+	if ( c->used < c->entries )
+		e = &c->entry[ c->used++ ];
+	else
+	{
+		e = c->tail;
+		lru_unlink( c, e );
+
+		for ( p = bucket_of( c, e->key, e->ms.len ); *p != e; p = &( *p )->chain )
+			;
+
+		*p = e->chain;
+	}
+
+	e->key = key;
+	e->ms = *ms;
+
+	p = bucket_of( c, key, ms->len );
+	e->chain = *p;
+	*p = e;
+	lru_push( c, e );
+}
+
+struct sha256_prefix_cache *sha256_prefix_cache_create( size_t entries )
+{
+	struct sha256_prefix_cache *c = calloc( 1, sizeof( *c ) );
+	size_t buckets = 1;
+
+	if ( c == NULL )
+		return NULL;
+
+	if ( entries == 0 )
+		entries = SHA256_PREFIX_CACHE_SIZE;
+
+	while ( buckets < entries )
+		buckets *= 2;
+
+	c->entries = entries;
+	c->mask = buckets - 1;
+	c->bucket = calloc( buckets, sizeof( *c->bucket ) );
+	c->entry = calloc( entries, sizeof( *c->entry ) );
+
+	if ( c->bucket == NULL || c->entry == NULL )
+	{
+		free( c->bucket );
+		free( c->entry );
+		free( c );
+		return NULL;
+	}
+
+	pthread_mutex_init( &c->lock, NULL );
+
+	return c;
+}
+
+void sha256_prefix_cache_destroy( struct sha256_prefix_cache *c )
+{
+	if ( c == NULL )
+		return;
+
+	pthread_mutex_destroy( &c->lock );
+	free( c->bucket );
+	free( c->entry );
+	free( c );
+}
+
+int sha256_prefix_init( struct sha256_prefix_cache *c, struct sha256_ctx *ctx, uint64_t key, const uint8_t *prefix, size_t len )
+{
+	size_t bulk = len & ~( size_t ) 63;
+	struct sha256_midstate ms;
+	struct entry *e;
+	int hit;
+
+	/*
+	 * Without a whole block there's nothing to cache.
+	 */
+
+	if ( bulk == 0 )
+	{
+		sha256_init( ctx );
+		sha256_update( ctx, prefix, len );
+		return 0;
+	}
+
+	pthread_mutex_lock( &c->lock );
+	e = lookup( c, key, bulk );
+	if ( e != NULL )
+		ms = e->ms;
+	pthread_mutex_unlock( &c->lock );
+
+	hit = e != NULL;
+
+	if ( !hit )
+	{
+		memcpy( ms.H, sha256_H0, sizeof( sha256_H0 ) );
+		ms.len = bulk;
+		sha256_compress( ms.H, prefix, bulk / 64 );
+
+		/*
+		 * Another thread may have hashed the same prefix in the meantime,
+		 * keep just one copy.
+		 */
+
+		pthread_mutex_lock( &c->lock );
+		if ( lookup( c, key, bulk ) == NULL )
+			insert( c, key, &ms );
+		pthread_mutex_unlock( &c->lock );
+	}
+
+	sha256_import( ctx, &ms );
+	sha256_update( ctx, &prefix[ bulk ], len - bulk );
+
+	return hit;
+}
@@ -0,0 +1,61 @@
+#ifndef SHA256_PREFIX_H
+#define SHA256_PREFIX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256.h"
+
+/*
+ * Cache of midstates for messages that share a fixed prefix, a protocol
+ * header, a salt or a domain tag. The first message with a given prefix hashes
+ * its whole blocks and keeps the state after them, every later one starts
+ * from that state and only hashes the prefix's last partial block, if any,
+ * and its own suffix.
+ *
+ * Prefixes are looked up by a key chosen by the caller rather than by their
+ * bytes, comparing the bytes would cost about as much as hashing them. Two
+ * different prefixes must never be given the same key. When the cache is full
+ * the least recently used prefix is dropped.
+ *
+ * A cache can be shared between threads.
+ */
+
+struct sha256_prefix_cache;
+
+#define SHA256_PREFIX_CACHE_SIZE 64
+
+/**
+ * sha256_prefix_cache_create - allocate an empty cache
+ * @entries: number of prefixes to keep, 0 for SHA256_PREFIX_CACHE_SIZE
+ *
+ * Return: the new cache, or NULL if it couldn't be allocated
+ */
+
+struct sha256_prefix_cache *sha256_prefix_cache_create( size_t entries );
+
+/**
+ * sha256_prefix_cache_destroy - free a cache
+ * @c: cache, may be NULL
+ */
+
+void sha256_prefix_cache_destroy( struct sha256_prefix_cache *c );
+
+/**
+ * sha256_prefix_init - start a message with a prefix
+ * @c: cache
+ * @ctx: context to initialize
+ * @key: identifies the prefix
+ * @prefix: the prefix bytes
+ * @len: length of prefix in number of bytes
+ *
+ * Leaves ctx in the same state as sha256_init followed by sha256_update with
+ * the prefix. The rest of the message is then added with sha256_update. A
+ * prefix shorter than a block is simply absorbed and never cached.
+ *
+ * Return: 1 if the prefix's blocks came from the cache, 0 if they were hashed
+ */
+
+int sha256_prefix_init( struct sha256_prefix_cache *c, struct sha256_ctx *ctx, uint64_t key, const uint8_t *prefix, size_t len );
+
+#endif
@@ -0,0 +1,75 @@
+#include "sha256_internal.h"
+
+/*
+ * Portable scalar compression kernel. This is what runs on machines without
+ * any of the SIMD or SHA extensions.
+ *
+ * All 64 rounds are unrolled. Instead of moving every working variable along
+ * by one after each round the names are rotated in the ROUND arguments, so
+ * the compiler can keep a..h in registers and only ever writes two of them per
+ * round. The message schedule only ever looks back 16 words, so it is kept in
+ * a 16 word circular window rather than a 64 word array.
+ */
+
+#define KW_LOAD( t ) \
+	( sha256_K[ t ] + ( W[ t ] = LOAD32_BE( &data[ ( t ) * 4 ] ) ) )
+
+/*
+ * The kernel body is written once and instantiated for each target below.
+ */
+
+SHA256_INLINE
+void sha256_compress_scalar_body( uint32_t *H, const uint8_t *data, size_t nblocks )
+{
+	uint32_t W[ 16 ];
+	uint32_t a, b, c, d, e, f, g, h;
+
+	for ( ; nblocks > 0; nblocks--, data += 64 )
+	{
+		a = H[ 0 ];
+		b = H[ 1 ];
+		c = H[ 2 ];
+		d = H[ 3 ];
+		e = H[ 4 ];
+		f = H[ 5 ];
+		g = H[ 6 ];
+		h = H[ 7 ];
+
+		ROUNDS8(  0, KW_LOAD );
+		ROUNDS8(  8, KW_LOAD );
+		ROUNDS8( 16, KW_NEXT );
+		ROUNDS8( 24, KW_NEXT );
+		ROUNDS8( 32, KW_NEXT );
+		ROUNDS8( 40, KW_NEXT );
+		ROUNDS8( 48, KW_NEXT );
+		ROUNDS8( 56, KW_NEXT );
+
+		H[ 0 ] += a;
+		H[ 1 ] += b;
+		H[ 2 ] += c;
+		H[ 3 ] += d;
+		H[ 4 ] += e;
+		H[ 5 ] += f;
+		H[ 6 ] += g;
+		H[ 7 ] += h;
+	}
+}
+
+void sha256_compress_scalar( uint32_t *H, const uint8_t *data, size_t nblocks )
+{
+	sha256_compress_scalar_body( H, data, nblocks );
+}
+
+#if defined( SHA256_X86 )
+
+/*
+ * Same kernel built for BMI2 so every rotate becomes a rorx.
+ */
+
+__attribute__( ( target( "bmi2" ) ) )
+void sha256_compress_scalar_bmi2( uint32_t *H, const uint8_t *data, size_t nblocks )
+{
+	sha256_compress_scalar_body( H, data, nblocks );
+}
+
+#endif
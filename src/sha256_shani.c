@@ -0,0 +1,429 @@
+#include "sha256_internal.h"
+
+#if defined( SHA256_X86 )
+
+#include <immintrin.h>
+
+/*
+ * Intel SHA extensions kernel.
+ *
+ * sha256rnds2 does two rounds at a time but wants the state split across two
+ * registers as ABEF and CDGH instead of the ABCD and EFGH order of H. We
+ * convert on the way in, keep that layout for every block of the call and
+ * only convert back once at the end. sha256msg1 and sha256msg2 do most of the
+ * message schedule, four words at a time, the only part left to us is the
+ * W(t-7) term which is pulled out of the previous two groups with palignr.
+ *
+ * Resources:
+ * https://www.intel.com/content/www/us/en/developer/articles/technical/intel-sha-extensions.html
+ * https://github.com/noloader/SHA-Intrinsics/blob/master/sha256-x86.c
+ */
+
+#define SHANI_TARGET __attribute__( ( target( "sha,sse4.1" ) ) )
+
+/*
+ * Four rounds using the four schedule words in m.
+ */
+
+#define RNDS4( t, m ) do { \
+		MSG = _mm_add_epi32( ( m ), _mm_loadu_si128( ( const __m128i * ) &sha256_K[ t ] ) ); \
+		STATE1 = _mm_sha256rnds2_epu32( STATE1, STATE0, MSG ); \
+		MSG = _mm_shuffle_epi32( MSG, 0x0e ); \
+		STATE0 = _mm_sha256rnds2_epu32( STATE0, STATE1, MSG ); \
+	} while ( 0 )
+
+/*
+ * Finish the schedule words four groups ahead of cur and start the ones
+ * three groups ahead.
+ */
+
+#define SCHED2( next, cur, prev ) \
+	( next ) = _mm_sha256msg2_epu32( _mm_add_epi32( ( next ), _mm_alignr_epi8( ( cur ), ( prev ), 4 ) ), ( cur ) )
+
+#define SCHED1( prev, cur ) \
+	( prev ) = _mm_sha256msg1_epu32( ( prev ), ( cur ) )
+
+#define LOAD( m, i ) \
+	( m ) = _mm_shuffle_epi8( _mm_loadu_si128( ( const __m128i * ) &data[ ( i ) * 16 ] ), BSWAP_MASK )
+
+SHANI_TARGET
+void sha256_compress_shani( uint32_t *H, const uint8_t *data, size_t nblocks )
+{
+	const __m128i BSWAP_MASK = _mm_set_epi64x( 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL );
+	__m128i STATE0, STATE1, ABEF_SAVE, CDGH_SAVE;
+	__m128i MSG, MSG0, MSG1, MSG2, MSG3, TMP;
+
+	/*
+	 * ABCD EFGH -> ABEF CDGH
+	 */
+
+	TMP    = _mm_loadu_si128( ( const __m128i * ) &H[ 0 ] );
+	STATE1 = _mm_loadu_si128( ( const __m128i * ) &H[ 4 ] );
+	TMP    = _mm_shuffle_epi32( TMP, 0xb1 );
+	STATE1 = _mm_shuffle_epi32( STATE1, 0x1b );
+	STATE0 = _mm_alignr_epi8( TMP, STATE1, 8 );
+	STATE1 = _mm_blend_epi16( STATE1, TMP, 0xf0 );
+
+	for ( ; nblocks > 0; nblocks--, data += 64 )
+	{
+		ABEF_SAVE = STATE0;
+		CDGH_SAVE = STATE1;
+
+		LOAD( MSG0, 0 ); RNDS4(  0, MSG0 );
+		LOAD( MSG1, 1 ); RNDS4(  4, MSG1 ); SCHED1( MSG0, MSG1 );
+		LOAD( MSG2, 2 ); RNDS4(  8, MSG2 ); SCHED1( MSG1, MSG2 );
+		LOAD( MSG3, 3 ); RNDS4( 12, MSG3 ); SCHED2( MSG0, MSG3, MSG2 ); SCHED1( MSG2, MSG3 );
+
+		RNDS4( 16, MSG0 ); SCHED2( MSG1, MSG0, MSG3 ); SCHED1( MSG3, MSG0 );
+		RNDS4( 20, MSG1 ); SCHED2( MSG2, MSG1, MSG0 ); SCHED1( MSG0, MSG1 );
+		RNDS4( 24, MSG2 ); SCHED2( MSG3, MSG2, MSG1 ); SCHED1( MSG1, MSG2 );
+		RNDS4( 28, MSG3 ); SCHED2( MSG0, MSG3, MSG2 ); SCHED1( MSG2, MSG3 );
+		RNDS4( 32, MSG0 ); SCHED2( MSG1, MSG0, MSG3 ); SCHED1( MSG3, MSG0 );
+		RNDS4( 36, MSG1 ); SCHED2( MSG2, MSG1, MSG0 ); SCHED1( MSG0, MSG1 );
+		RNDS4( 40, MSG2 ); SCHED2( MSG3, MSG2, MSG1 ); SCHED1( MSG1, MSG2 );
+		RNDS4( 44, MSG3 ); SCHED2( MSG0, MSG3, MSG2 ); SCHED1( MSG2, MSG3 );
+		RNDS4( 48, MSG0 ); SCHED2( MSG1, MSG0, MSG3 ); SCHED1( MSG3, MSG0 );
+		RNDS4( 52, MSG1 ); SCHED2( MSG2, MSG1, MSG0 );
+		RNDS4( 56, MSG2 ); SCHED2( MSG3, MSG2, MSG1 );
+		RNDS4( 60, MSG3 );
+
+		STATE0 = _mm_add_epi32( STATE0, ABEF_SAVE );
+		STATE1 = _mm_add_epi32( STATE1, CDGH_SAVE );
+	}
+
+	/*
+	 * ABEF CDGH -> ABCD EFGH
+	 */
+
+	TMP    = _mm_shuffle_epi32( STATE0, 0x1b );
+	STATE1 = _mm_shuffle_epi32( STATE1, 0xb1 );
+	STATE0 = _mm_blend_epi16( TMP, STATE1, 0xf0 );
+	STATE1 = _mm_alignr_epi8( STATE1, TMP, 8 );
+
+	_mm_storeu_si128( ( __m128i * ) &H[ 0 ], STATE0 );
+	_mm_storeu_si128( ( __m128i * ) &H[ 4 ], STATE1 );
+}
+
+/*
+ * Two messages at a time.
+ *
+ * sha256rnds2 has a latency of several cycles and every round depends on the
+ * one before it, so a single stream leaves the SHA unit idle most of the
+ * time. Two independent messages interleaved instruction by instruction keep
+ * it busy, and share the round constant loads. Each message has its own copy
+ * of the state and schedule registers, suffixed A and B.
+ */
+
+#define RNDS4_X2( t, i ) do { \
+		KV = _mm_loadu_si128( ( const __m128i * ) &sha256_K[ t ] ); \
+		MSGA = _mm_add_epi32( MA##i, KV ); \
+		MSGB = _mm_add_epi32( MB##i, KV ); \
+		STATE1A = _mm_sha256rnds2_epu32( STATE1A, STATE0A, MSGA ); \
+		STATE1B = _mm_sha256rnds2_epu32( STATE1B, STATE0B, MSGB ); \
+		MSGA = _mm_shuffle_epi32( MSGA, 0x0e ); \
+		MSGB = _mm_shuffle_epi32( MSGB, 0x0e ); \
+		STATE0A = _mm_sha256rnds2_epu32( STATE0A, STATE1A, MSGA ); \
+		STATE0B = _mm_sha256rnds2_epu32( STATE0B, STATE1B, MSGB ); \
+	} while ( 0 )
+
+#define SCHED2_X2( n, c, p ) do { \
+		SCHED2( MA##n, MA##c, MA##p ); \
+		SCHED2( MB##n, MB##c, MB##p ); \
+	} while ( 0 )
+
+#define SCHED1_X2( p, c ) do { \
+		SCHED1( MA##p, MA##c ); \
+		SCHED1( MB##p, MB##c ); \
+	} while ( 0 )
+
+#define LOAD_X2( i ) do { \
+		MA##i = _mm_shuffle_epi8( _mm_loadu_si128( ( const __m128i * ) &data[ 0 ][ off + ( i ) * 16 ] ), BSWAP_MASK ); \
+		MB##i = _mm_shuffle_epi8( _mm_loadu_si128( ( const __m128i * ) &data[ 1 ][ off + ( i ) * 16 ] ), BSWAP_MASK ); \
+	} while ( 0 )
+
+/*
+ * ABCD EFGH <-> ABEF CDGH for one lane of the transposed multi-buffer state.
+ */
+
+#define STATE_IN( S0, S1, l ) do { \
+		S0 = _mm_set_epi32( state[ 0 * 2 + l ], state[ 1 * 2 + l ], state[ 4 * 2 + l ], state[ 5 * 2 + l ] ); \
+		S1 = _mm_set_epi32( state[ 2 * 2 + l ], state[ 3 * 2 + l ], state[ 6 * 2 + l ], state[ 7 * 2 + l ] ); \
+	} while ( 0 )
+
+#define STATE_OUT( S0, S1, l ) do { \
+		uint32_t out[ 8 ]; \
+		_mm_storeu_si128( ( __m128i * ) &out[ 0 ], S0 ); \
+		_mm_storeu_si128( ( __m128i * ) &out[ 4 ], S1 ); \
+		state[ 0 * 2 + l ] = out[ 3 ]; \
+		state[ 1 * 2 + l ] = out[ 2 ]; \
+		state[ 4 * 2 + l ] = out[ 1 ]; \
+		state[ 5 * 2 + l ] = out[ 0 ]; \
+		state[ 2 * 2 + l ] = out[ 7 ]; \
+		state[ 3 * 2 + l ] = out[ 6 ]; \
+		state[ 6 * 2 + l ] = out[ 5 ]; \
+		state[ 7 * 2 + l ] = out[ 4 ]; \
+	} while ( 0 )
+
+SHANI_TARGET
+void sha256_mb_shani_x2( uint32_t *state, const uint8_t *const *data, size_t nblocks )
+{
+	const __m128i BSWAP_MASK = _mm_set_epi64x( 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL );
+	__m128i STATE0A, STATE1A, STATE0B, STATE1B, SAVE0A, SAVE1A, SAVE0B, SAVE1B;
+	__m128i MSGA, MA0, MA1, MA2, MA3;
+	__m128i MSGB, MB0, MB1, MB2, MB3;
+	__m128i KV;
+
+	STATE_IN( STATE0A, STATE1A, 0 );
+	STATE_IN( STATE0B, STATE1B, 1 );
+
+	for ( size_t off = 0; off < nblocks * 64; off += 64 )
+	{
+		SAVE0A = STATE0A;
+		SAVE1A = STATE1A;
+		SAVE0B = STATE0B;
+		SAVE1B = STATE1B;
+
+		LOAD_X2( 0 ); RNDS4_X2(  0, 0 );
+		LOAD_X2( 1 ); RNDS4_X2(  4, 1 ); SCHED1_X2( 0, 1 );
+		LOAD_X2( 2 ); RNDS4_X2(  8, 2 ); SCHED1_X2( 1, 2 );
+		LOAD_X2( 3 ); RNDS4_X2( 12, 3 ); SCHED2_X2( 0, 3, 2 ); SCHED1_X2( 2, 3 );
+
+		RNDS4_X2( 16, 0 ); SCHED2_X2( 1, 0, 3 ); SCHED1_X2( 3, 0 );
+		RNDS4_X2( 20, 1 ); SCHED2_X2( 2, 1, 0 ); SCHED1_X2( 0, 1 );
+		RNDS4_X2( 24, 2 ); SCHED2_X2( 3, 2, 1 ); SCHED1_X2( 1, 2 );
+		RNDS4_X2( 28, 3 ); SCHED2_X2( 0, 3, 2 ); SCHED1_X2( 2, 3 );
+		RNDS4_X2( 32, 0 ); SCHED2_X2( 1, 0, 3 ); SCHED1_X2( 3, 0 );
+		RNDS4_X2( 36, 1 ); SCHED2_X2( 2, 1, 0 ); SCHED1_X2( 0, 1 );
+		RNDS4_X2( 40, 2 ); SCHED2_X2( 3, 2, 1 ); SCHED1_X2( 1, 2 );
+		RNDS4_X2( 44, 3 ); SCHED2_X2( 0, 3, 2 ); SCHED1_X2( 2, 3 );
+		RNDS4_X2( 48, 0 ); SCHED2_X2( 1, 0, 3 ); SCHED1_X2( 3, 0 );
+		RNDS4_X2( 52, 1 ); SCHED2_X2( 2, 1, 0 );
+		RNDS4_X2( 56, 2 ); SCHED2_X2( 3, 2, 1 );
+		RNDS4_X2( 60, 3 );
+
+		STATE0A = _mm_add_epi32( STATE0A, SAVE0A );
+		STATE1A = _mm_add_epi32( STATE1A, SAVE1A );
+		STATE0B = _mm_add_epi32( STATE0B, SAVE0B );
+		STATE1B = _mm_add_epi32( STATE1B, SAVE1B );
+	}
+
+	STATE_OUT( STATE0A, STATE1A, 0 );
+	STATE_OUT( STATE0B, STATE1B, 1 );
+}
+
+/*
+ * Double hash of two 64 byte messages, see sha256_d64.c. Both lanes share
+ * the constant round inputs of the padding blocks.
+ */
+
+#define RNDS4_KW_X2( kw ) do { \
+		MSGA = _mm_loadu_si128( ( const __m128i * ) ( kw ) ); \
+		STATE1A = _mm_sha256rnds2_epu32( STATE1A, STATE0A, MSGA ); \
+		STATE1B = _mm_sha256rnds2_epu32( STATE1B, STATE0B, MSGA ); \
+		MSGA = _mm_shuffle_epi32( MSGA, 0x0e ); \
+		STATE0A = _mm_sha256rnds2_epu32( STATE0A, STATE1A, MSGA ); \
+		STATE0B = _mm_sha256rnds2_epu32( STATE0B, STATE1B, MSGA ); \
+	} while ( 0 )
+
+/*
+ * Rounds 16 to 63, the same for every block once the first four groups of
+ * schedule words are in.
+ */
+
+#define RNDS16_63_X2() do { \
+		RNDS4_X2( 16, 0 ); SCHED2_X2( 1, 0, 3 ); SCHED1_X2( 3, 0 ); \
+		RNDS4_X2( 20, 1 ); SCHED2_X2( 2, 1, 0 ); SCHED1_X2( 0, 1 ); \
+		RNDS4_X2( 24, 2 ); SCHED2_X2( 3, 2, 1 ); SCHED1_X2( 1, 2 ); \
+		RNDS4_X2( 28, 3 ); SCHED2_X2( 0, 3, 2 ); SCHED1_X2( 2, 3 ); \
+		RNDS4_X2( 32, 0 ); SCHED2_X2( 1, 0, 3 ); SCHED1_X2( 3, 0 ); \
+		RNDS4_X2( 36, 1 ); SCHED2_X2( 2, 1, 0 ); SCHED1_X2( 0, 1 ); \
+		RNDS4_X2( 40, 2 ); SCHED2_X2( 3, 2, 1 ); SCHED1_X2( 1, 2 ); \
+		RNDS4_X2( 44, 3 ); SCHED2_X2( 0, 3, 2 ); SCHED1_X2( 2, 3 ); \
+		RNDS4_X2( 48, 0 ); SCHED2_X2( 1, 0, 3 ); SCHED1_X2( 3, 0 ); \
+		RNDS4_X2( 52, 1 ); SCHED2_X2( 2, 1, 0 ); \
+		RNDS4_X2( 56, 2 ); SCHED2_X2( 3, 2, 1 ); \
+		RNDS4_X2( 60, 3 ); \
+	} while ( 0 )
+
+/*
+ * ABEF CDGH -> ABCD EFGH, in place.
+ */
+
+#define TO_ABCD( S0, S1 ) do { \
+		__m128i T = _mm_shuffle_epi32( S0, 0x1b ); \
+		S1 = _mm_shuffle_epi32( S1, 0xb1 ); \
+		S0 = _mm_blend_epi16( T, S1, 0xf0 ); \
+		S1 = _mm_alignr_epi8( S1, T, 8 ); \
+	} while ( 0 )
+
+/**
+ * kw_rounds_x2 - compress a block given as K + W for every round
+ * @S: state of both lanes as ABEF and CDGH, lane A then lane B, updated
+ * @kw: K + W for rounds 0 to 63, the same for both lanes
+ */
+
+SHA256_INLINE SHANI_TARGET
+void kw_rounds_x2( __m128i *S, const uint32_t *kw )
+{
+	__m128i STATE0A = S[ 0 ], STATE1A = S[ 1 ], STATE0B = S[ 2 ], STATE1B = S[ 3 ];
+	__m128i MSGA;
+
+	for ( size_t t = 0; t < 64; t += 4 )
+		RNDS4_KW_X2( &kw[ t ] );
+
+	S[ 0 ] = _mm_add_epi32( STATE0A, S[ 0 ] );
+	S[ 1 ] = _mm_add_epi32( STATE1A, S[ 1 ] );
+	S[ 2 ] = _mm_add_epi32( STATE0B, S[ 2 ] );
+	S[ 3 ] = _mm_add_epi32( STATE1B, S[ 3 ] );
+}
+
+SHANI_TARGET
+void sha256_kw_block_shani_x2( uint32_t *state, const uint32_t *kw )
+{
+	__m128i S[ 4 ];
+
+	STATE_IN( S[ 0 ], S[ 1 ], 0 );
+	STATE_IN( S[ 2 ], S[ 3 ], 1 );
+
+	kw_rounds_x2( S, kw );
+
+	STATE_OUT( S[ 0 ], S[ 1 ], 0 );
+	STATE_OUT( S[ 2 ], S[ 3 ], 1 );
+}
+
+SHANI_TARGET
+void sha256d64_shani_x2( uint8_t *out, const uint8_t *in )
+{
+	const __m128i BSWAP_MASK = _mm_set_epi64x( 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL );
+	const __m128i INIT0 = _mm_set_epi32( ( int ) sha256_H0[ 0 ], ( int ) sha256_H0[ 1 ], ( int ) sha256_H0[ 4 ], ( int ) sha256_H0[ 5 ] );
+	const __m128i INIT1 = _mm_set_epi32( ( int ) sha256_H0[ 2 ], ( int ) sha256_H0[ 3 ], ( int ) sha256_H0[ 6 ], ( int ) sha256_H0[ 7 ] );
+	const uint8_t *data[ 2 ] = { &in[ 0 ], &in[ 64 ] };
+	const size_t off = 0;
+	__m128i STATE0A, STATE1A, STATE0B, STATE1B;
+	__m128i MSGA, MA0, MA1, MA2, MA3;
+	__m128i MSGB, MB0, MB1, MB2, MB3;
+	__m128i KV, S[ 4 ];
+
+	/*
+	 * The message block.
+	 */
+
+	STATE0A = STATE0B = INIT0;
+	STATE1A = STATE1B = INIT1;
+
+	LOAD_X2( 0 ); RNDS4_X2(  0, 0 );
+	LOAD_X2( 1 ); RNDS4_X2(  4, 1 ); SCHED1_X2( 0, 1 );
+	LOAD_X2( 2 ); RNDS4_X2(  8, 2 ); SCHED1_X2( 1, 2 );
+	LOAD_X2( 3 ); RNDS4_X2( 12, 3 ); SCHED2_X2( 0, 3, 2 ); SCHED1_X2( 2, 3 );
+	RNDS16_63_X2();
+
+	S[ 0 ] = _mm_add_epi32( STATE0A, INIT0 );
+	S[ 1 ] = _mm_add_epi32( STATE1A, INIT1 );
+	S[ 2 ] = _mm_add_epi32( STATE0B, INIT0 );
+	S[ 3 ] = _mm_add_epi32( STATE1B, INIT1 );
+
+	/*
+	 * The padding block, no schedule to compute.
+	 */
+
+	kw_rounds_x2( S, sha256_pad64_kw );
+
+	STATE0A = S[ 0 ];
+	STATE1A = S[ 1 ];
+	STATE0B = S[ 2 ];
+	STATE1B = S[ 3 ];
+
+	/*
+	 * Second hash, the digest is the first half of the block.
+	 */
+
+	TO_ABCD( STATE0A, STATE1A );
+	TO_ABCD( STATE0B, STATE1B );
+
+	MA0 = STATE0A;
+	MA1 = STATE1A;
+	MB0 = STATE0B;
+	MB1 = STATE1B;
+	MA2 = MB2 = _mm_loadu_si128( ( const __m128i * ) &sha256_pad32_w[ 0 ] );
+	MA3 = MB3 = _mm_loadu_si128( ( const __m128i * ) &sha256_pad32_w[ 4 ] );
+
+	STATE0A = STATE0B = INIT0;
+	STATE1A = STATE1B = INIT1;
+
+	RNDS4_X2(  0, 0 );
+	RNDS4_X2(  4, 1 ); SCHED1_X2( 0, 1 );
+	RNDS4_KW_X2( &sha256_pad32_kw[ 0 ] ); SCHED1_X2( 1, 2 );
+	RNDS4_KW_X2( &sha256_pad32_kw[ 4 ] ); SCHED2_X2( 0, 3, 2 ); SCHED1_X2( 2, 3 );
+	RNDS16_63_X2();
+
+	STATE0A = _mm_add_epi32( STATE0A, INIT0 );
+	STATE1A = _mm_add_epi32( STATE1A, INIT1 );
+	STATE0B = _mm_add_epi32( STATE0B, INIT0 );
+	STATE1B = _mm_add_epi32( STATE1B, INIT1 );
+
+	TO_ABCD( STATE0A, STATE1A );
+	TO_ABCD( STATE0B, STATE1B );
+
+	_mm_storeu_si128( ( __m128i * ) &out[  0 ], _mm_shuffle_epi8( STATE0A, BSWAP_MASK ) );
+	_mm_storeu_si128( ( __m128i * ) &out[ 16 ], _mm_shuffle_epi8( STATE1A, BSWAP_MASK ) );
+	_mm_storeu_si128( ( __m128i * ) &out[ 32 ], _mm_shuffle_epi8( STATE0B, BSWAP_MASK ) );
+	_mm_storeu_si128( ( __m128i * ) &out[ 48 ], _mm_shuffle_epi8( STATE1B, BSWAP_MASK ) );
+}
+
+/*
+ * Hash chains of two values, see sha256_chain.c.
+ */
+
+SHANI_TARGET
+void sha256_chain_shani_x2( uint8_t *md, uint64_t iter )
+{
+	const __m128i BSWAP_MASK = _mm_set_epi64x( 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL );
+	const __m128i INIT0 = _mm_set_epi32( ( int ) sha256_H0[ 0 ], ( int ) sha256_H0[ 1 ], ( int ) sha256_H0[ 4 ], ( int ) sha256_H0[ 5 ] );
+	const __m128i INIT1 = _mm_set_epi32( ( int ) sha256_H0[ 2 ], ( int ) sha256_H0[ 3 ], ( int ) sha256_H0[ 6 ], ( int ) sha256_H0[ 7 ] );
+	const __m128i PAD0 = _mm_loadu_si128( ( const __m128i * ) &sha256_pad32_w[ 0 ] );
+	const __m128i PAD1 = _mm_loadu_si128( ( const __m128i * ) &sha256_pad32_w[ 4 ] );
+	const uint8_t *data[ 2 ] = { &md[ 0 ], &md[ 32 ] };
+	const size_t off = 0;
+	__m128i STATE0A, STATE1A, STATE0B, STATE1B;
+	__m128i MSGA, MA0, MA1, MA2, MA3;
+	__m128i MSGB, MB0, MB1, MB2, MB3;
+	__m128i KV;
+
+	LOAD_X2( 0 );
+	LOAD_X2( 1 );
+
+	while ( iter-- > 0 )
+	{
+		MA2 = MB2 = PAD0;
+		MA3 = MB3 = PAD1;
+
+		STATE0A = STATE0B = INIT0;
+		STATE1A = STATE1B = INIT1;
+
+		RNDS4_X2(  0, 0 );
+		RNDS4_X2(  4, 1 ); SCHED1_X2( 0, 1 );
+		RNDS4_KW_X2( &sha256_pad32_kw[ 0 ] ); SCHED1_X2( 1, 2 );
+		RNDS4_KW_X2( &sha256_pad32_kw[ 4 ] ); SCHED2_X2( 0, 3, 2 ); SCHED1_X2( 2, 3 );
+		RNDS16_63_X2();
+
+		STATE0A = _mm_add_epi32( STATE0A, INIT0 );
+		STATE1A = _mm_add_epi32( STATE1A, INIT1 );
+		STATE0B = _mm_add_epi32( STATE0B, INIT0 );
+		STATE1B = _mm_add_epi32( STATE1B, INIT1 );
+
+		TO_ABCD( STATE0A, STATE1A );
+		TO_ABCD( STATE0B, STATE1B );
+
+		MA0 = STATE0A;
+		MA1 = STATE1A;
+		MB0 = STATE0B;
+		MB1 = STATE1B;
+	}
+
+	_mm_storeu_si128( ( __m128i * ) &md[  0 ], _mm_shuffle_epi8( MA0, BSWAP_MASK ) );
+	_mm_storeu_si128( ( __m128i * ) &md[ 16 ], _mm_shuffle_epi8( MA1, BSWAP_MASK ) );
+	_mm_storeu_si128( ( __m128i * ) &md[ 32 ], _mm_shuffle_epi8( MB0, BSWAP_MASK ) );
+	_mm_storeu_si128( ( __m128i * ) &md[ 48 ], _mm_shuffle_epi8( MB1, BSWAP_MASK ) );
+}
+
+#endif
@@ -0,0 +1,268 @@
+#include "sha256_internal.h"
+
+#if defined( SHA256_X86 )
+
+#include <immintrin.h>
+
+/*
+ * Single stream kernels with a vectorized message schedule, for machines
+ * without the SHA extensions.
+ *
+ * The rounds are inherently scalar, but the schedule is not: four new words
+ * only depend on words at least two positions back, so they can be computed
+ * together in one xmm register (the last two of them in a second pass once
+ * the first two are known). The schedule words are stored with the round
+ * constants already added, which leaves the rounds a single memory operand to
+ * read. The schedule for the next block is computed while the rounds of the
+ * current one run, the two are independent so the out of order core overlaps
+ * the vector work with the scalar dependency chain.
+ *
+ * The AVX2 kernel goes one step further and schedules two blocks at once, one
+ * in each 128 bit half of a ymm register, in the style of Intel's AVX2
+ * implementation. It is built for BMI2 as well so its rotates are rorx.
+ *
+ * Resources:
+ * https://www.intel.com/content/dam/www/public/us/en/documents/white-papers/sha-256-implementations-paper.pdf
+ * https://github.com/intel/intel-ipsec-mb/blob/main/lib/avx2_t1/sha256_one_block_avx2.asm
+ */
+
+#define SSSE3_TARGET __attribute__( ( target( "ssse3" ) ) )
+#define AVX2_TARGET __attribute__( ( target( "avx2,bmi2" ) ) )
+
+typedef uint32_t v4u32 __attribute__( ( vector_size( 16 ) ) );
+typedef uint32_t v8u32 __attribute__( ( vector_size( 32 ) ) );
+
+/**
+ * sched4_128 - compute the next four schedule words
+ * @X0: W(t-16) .. W(t-13)
+ * @X1: W(t-12) .. W(t-9)
+ * @X2: W(t-8) .. W(t-5)
+ * @X3: W(t-4) .. W(t-1)
+ *
+ * Return: W(t) .. W(t+3)
+ */
+
+SHA256_INLINE SSSE3_TARGET
+v4u32 sched4_128( v4u32 X0, v4u32 X1, v4u32 X2, v4u32 X3 )
+{
+	v4u32 w15 = ( v4u32 ) _mm_alignr_epi8( ( __m128i ) X1, ( __m128i ) X0, 4 );
+	v4u32 w7  = ( v4u32 ) _mm_alignr_epi8( ( __m128i ) X3, ( __m128i ) X2, 4 );
+	v4u32 t   = X0 + s0( w15 ) + w7;
+
+	// W(t) and W(t+1) from W(t-2) and W(t-1), then the other two from those
+	v4u32 lo  = t + s1( ( v4u32 ) _mm_shuffle_epi32( ( __m128i ) X3, 0xee ) );
+	v4u32 hi  = t + s1( ( v4u32 ) _mm_shuffle_epi32( ( __m128i ) lo, 0x44 ) );
+
+	return ( v4u32 ) _mm_castpd_si128( _mm_move_sd( _mm_castsi128_pd( ( __m128i ) hi ), _mm_castsi128_pd( ( __m128i ) lo ) ) );
+}
+
+/**
+ * sched4_256 - sched4_128 for two blocks at once, one per 128 bit half
+ */
+
+SHA256_INLINE AVX2_TARGET
+v8u32 sched4_256( v8u32 X0, v8u32 X1, v8u32 X2, v8u32 X3 )
+{
+	v8u32 w15 = ( v8u32 ) _mm256_alignr_epi8( ( __m256i ) X1, ( __m256i ) X0, 4 );
+	v8u32 w7  = ( v8u32 ) _mm256_alignr_epi8( ( __m256i ) X3, ( __m256i ) X2, 4 );
+	v8u32 t   = X0 + s0( w15 ) + w7;
+
+	v8u32 lo  = t + s1( ( v8u32 ) _mm256_shuffle_epi32( ( __m256i ) X3, 0xee ) );
+	v8u32 hi  = t + s1( ( v8u32 ) _mm256_shuffle_epi32( ( __m256i ) lo, 0x44 ) );
+
+	return ( v8u32 ) _mm256_blend_epi32( ( __m256i ) lo, ( __m256i ) hi, 0xcc );
+}
+
+/*
+ * SSSE3, one block at a time. Step j of the schedule produces words 4j to
+ * 4j + 3 of the block at next and stores them, plus the round constants, in
+ * WK_next.
+ */
+
+#define STEP_128( j ) do { \
+		if ( ( j ) < 4 ) \
+			X[ ( j ) & 3 ] = ( v4u32 ) _mm_shuffle_epi8( _mm_loadu_si128( ( const __m128i * ) &next[ ( j ) * 16 ] ), BSWAP ); \
+		else \
+			X[ ( j ) & 3 ] = sched4_128( X[ ( j ) & 3 ], X[ ( ( j ) + 1 ) & 3 ], X[ ( ( j ) + 2 ) & 3 ], X[ ( ( j ) + 3 ) & 3 ] ); \
+		_mm_store_si128( ( __m128i * ) &WK_next[ ( j ) * 4 ], \
+			( __m128i ) ( X[ ( j ) & 3 ] + ( v4u32 ) _mm_loadu_si128( ( const __m128i * ) &sha256_K[ ( j ) * 4 ] ) ) ); \
+	} while ( 0 )
+
+#define WK_CUR( t ) ( WK_cur[ t ] )
+
+SSSE3_TARGET
+void sha256_compress_ssse3( uint32_t *H, const uint8_t *data, size_t nblocks )
+{
+	const __m128i BSWAP = _mm_set_epi8( 12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3 );
+	uint32_t WK[ 2 ][ 64 ] __attribute__( ( aligned( 16 ) ) );
+	uint32_t a, b, c, d, e, f, g, h;
+	v4u32 X[ 4 ];
+
+	if ( nblocks == 0 )
+		return;
+
+	/*
+	 * The first block's schedule has nothing to hide behind.
+	 */
+
+	uint32_t *WK_cur = WK[ 0 ], *WK_next = WK[ 0 ];
+	const uint8_t *next = data;
+
+	STEP_128(  0 ); STEP_128(  1 ); STEP_128(  2 ); STEP_128(  3 );
+	STEP_128(  4 ); STEP_128(  5 ); STEP_128(  6 ); STEP_128(  7 );
+	STEP_128(  8 ); STEP_128(  9 ); STEP_128( 10 ); STEP_128( 11 );
+	STEP_128( 12 ); STEP_128( 13 ); STEP_128( 14 ); STEP_128( 15 );
+
+	for ( size_t i = 0; i < nblocks; i++, data += 64 )
+	{
+		WK_cur = WK[ i & 1 ];
+		WK_next = WK[ ( i + 1 ) & 1 ];
+
+		// on the last block this schedules it again, and throws it away
+		next = i + 1 < nblocks ? data + 64 : data;
+
+		a = H[ 0 ];
+		b = H[ 1 ];
+		c = H[ 2 ];
+		d = H[ 3 ];
+		e = H[ 4 ];
+		f = H[ 5 ];
+		g = H[ 6 ];
+		h = H[ 7 ];
+
+		ROUNDS8(  0, WK_CUR ); STEP_128(  0 ); STEP_128(  1 );
+		ROUNDS8(  8, WK_CUR ); STEP_128(  2 ); STEP_128(  3 );
+		ROUNDS8( 16, WK_CUR ); STEP_128(  4 ); STEP_128(  5 );
+		ROUNDS8( 24, WK_CUR ); STEP_128(  6 ); STEP_128(  7 );
+		ROUNDS8( 32, WK_CUR ); STEP_128(  8 ); STEP_128(  9 );
+		ROUNDS8( 40, WK_CUR ); STEP_128( 10 ); STEP_128( 11 );
+		ROUNDS8( 48, WK_CUR ); STEP_128( 12 ); STEP_128( 13 );
+		ROUNDS8( 56, WK_CUR ); STEP_128( 14 ); STEP_128( 15 );
+
+		H[ 0 ] += a;
+		H[ 1 ] += b;
+		H[ 2 ] += c;
+		H[ 3 ] += d;
+		H[ 4 ] += e;
+		H[ 5 ] += f;
+		H[ 6 ] += g;
+		H[ 7 ] += h;
+	}
+}
+
+/*
+ * AVX2, two blocks at a time. The schedule of a pair is stored interleaved,
+ * four words of the first block then the same four words of the second, so
+ * one ymm store covers both.
+ */
+
+#define STEP_256( j ) do { \
+		if ( ( j ) < 4 ) \
+			X[ ( j ) & 3 ] = ( v8u32 ) _mm256_shuffle_epi8( _mm256_inserti128_si256( \
+				_mm256_castsi128_si256( _mm_loadu_si128( ( const __m128i * ) &next0[ ( j ) * 16 ] ) ), \
+				_mm_loadu_si128( ( const __m128i * ) &next1[ ( j ) * 16 ] ), 1 ), BSWAP ); \
+		else \
+			X[ ( j ) & 3 ] = sched4_256( X[ ( j ) & 3 ], X[ ( ( j ) + 1 ) & 3 ], X[ ( ( j ) + 2 ) & 3 ], X[ ( ( j ) + 3 ) & 3 ] ); \
+		_mm256_store_si256( ( __m256i * ) &WK_next[ ( j ) * 8 ], ( __m256i ) ( X[ ( j ) & 3 ] + \
+			( v8u32 ) _mm256_broadcastsi128_si256( _mm_loadu_si128( ( const __m128i * ) &sha256_K[ ( j ) * 4 ] ) ) ) ); \
+	} while ( 0 )
+
+#define WK_CUR0( t ) ( WK_cur[ ( ( t ) / 4 ) * 8 +     ( ( t ) & 3 ) ] )
+#define WK_CUR1( t ) ( WK_cur[ ( ( t ) / 4 ) * 8 + 4 + ( ( t ) & 3 ) ] )
+
+AVX2_TARGET
+void sha256_compress_avx2( uint32_t *H, const uint8_t *data, size_t nblocks )
+{
+	const __m256i BSWAP = _mm256_set_epi8(
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3 );
+	uint32_t WK[ 2 ][ 128 ] __attribute__( ( aligned( 32 ) ) );
+	uint32_t a, b, c, d, e, f, g, h;
+	v8u32 X[ 4 ];
+
+	if ( nblocks == 0 )
+		return;
+
+	uint32_t *WK_cur = WK[ 0 ], *WK_next = WK[ 0 ];
+	const uint8_t *next0 = data;
+	const uint8_t *next1 = nblocks > 1 ? data + 64 : data;
+
+	STEP_256(  0 ); STEP_256(  1 ); STEP_256(  2 ); STEP_256(  3 );
+	STEP_256(  4 ); STEP_256(  5 ); STEP_256(  6 ); STEP_256(  7 );
+	STEP_256(  8 ); STEP_256(  9 ); STEP_256( 10 ); STEP_256( 11 );
+	STEP_256( 12 ); STEP_256( 13 ); STEP_256( 14 ); STEP_256( 15 );
+
+	for ( size_t i = 0; i < nblocks; i += 2, data += 128 )
+	{
+		WK_cur = WK[ ( i / 2 ) & 1 ];
+		WK_next = WK[ ( i / 2 + 1 ) & 1 ];
+
+		/*
+		 * The next pair, which may be a single block paired with itself, or
+		 * nothing at all in which case the current pair is scheduled again
+		 * and thrown away.
+		 */
+
+		next0 = i + 2 < nblocks ? data + 128 : data;
+		next1 = i + 3 < nblocks ? data + 192 : next0;
+
+		a = H[ 0 ];
+		b = H[ 1 ];
+		c = H[ 2 ];
+		d = H[ 3 ];
+		e = H[ 4 ];
+		f = H[ 5 ];
+		g = H[ 6 ];
+		h = H[ 7 ];
+
+		ROUNDS8(  0, WK_CUR0 ); STEP_256(  0 );
+		ROUNDS8(  8, WK_CUR0 ); STEP_256(  1 );
+		ROUNDS8( 16, WK_CUR0 ); STEP_256(  2 );
+		ROUNDS8( 24, WK_CUR0 ); STEP_256(  3 );
+		ROUNDS8( 32, WK_CUR0 ); STEP_256(  4 );
+		ROUNDS8( 40, WK_CUR0 ); STEP_256(  5 );
+		ROUNDS8( 48, WK_CUR0 ); STEP_256(  6 );
+		ROUNDS8( 56, WK_CUR0 ); STEP_256(  7 );
+
+		H[ 0 ] += a;
+		H[ 1 ] += b;
+		H[ 2 ] += c;
+		H[ 3 ] += d;
+		H[ 4 ] += e;
+		H[ 5 ] += f;
+		H[ 6 ] += g;
+		H[ 7 ] += h;
+
+		if ( i + 1 == nblocks )
+			break;
+
+		a = H[ 0 ];
+		b = H[ 1 ];
+		c = H[ 2 ];
+		d = H[ 3 ];
+		e = H[ 4 ];
+		f = H[ 5 ];
+		g = H[ 6 ];
+		h = H[ 7 ];
+
+		ROUNDS8(  0, WK_CUR1 ); STEP_256(  8 );
+		ROUNDS8(  8, WK_CUR1 ); STEP_256(  9 );
+		ROUNDS8( 16, WK_CUR1 ); STEP_256( 10 );
+		ROUNDS8( 24, WK_CUR1 ); STEP_256( 11 );
+		ROUNDS8( 32, WK_CUR1 ); STEP_256( 12 );
+		ROUNDS8( 40, WK_CUR1 ); STEP_256( 13 );
+		ROUNDS8( 48, WK_CUR1 ); STEP_256( 14 );
+		ROUNDS8( 56, WK_CUR1 ); STEP_256( 15 );
+
+		H[ 0 ] += a;
+		H[ 1 ] += b;
+		H[ 2 ] += c;
+		H[ 3 ] += d;
+		H[ 4 ] += e;
+		H[ 5 ] += f;
+		H[ 6 ] += g;
+		H[ 7 ] += h;
+	}
+}
+
+#endif
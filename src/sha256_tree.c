@@ -0,0 +1,149 @@
+#include <stdlib.h>
+
+#include "sha256_tree.h"
+#include "sha256_internal.h"
+
+/*
+ * Tree hash, see sha256_tree.h for the format.
+ *
+ * Leaves are handed out through a shared counter. One task per pool worker
+ * is submitted, and it and the calling thread keep taking the next unhashed
+ * leaf until there are none left. That keeps all cores busy
+ * to the end even when some of them are slower. The internal nodes are a tiny
+ * fraction of the work, one 65 byte message per pair of leaves, so the levels
+ * above the leaves are done on the calling thread.
+ */
+
+#define LEAF_PREFIX 0x00
+#define NODE_PREFIX 0x01
+
+struct tree
+{
+	const uint8_t *data;
+	size_t len;
+	size_t leaf_size;
+	size_t leaves;
+	size_t next;
+	uint8_t *md;
+};
+
+struct leaf_task
+{
+	struct sha256_task task;
+	struct tree *t;
+};
+
+/**
+ * hash_leaves - hash leaves until there are none left
+ * @t: tree being hashed
+ */
+
+static void hash_leaves( struct tree *t )
+{
+	const uint8_t prefix = LEAF_PREFIX;
+	size_t i;
+
+	while ( ( i = __atomic_fetch_add( &t->next, 1, __ATOMIC_RELAXED ) ) < t->leaves )
+	{
+		size_t off = i * t->leaf_size;
+		struct sha256_ctx ctx;
+
+		sha256_init( &ctx );
+		sha256_update( &ctx, &prefix, 1 );
+		sha256_update( &ctx, &t->data[ off ], MIN( t->leaf_size, t->len - off ) );
+		sha256_final( &ctx, &t->md[ i * 32 ] );
+	}
+}
+
+static void leaf_task( struct sha256_task *task )
+{
+	hash_leaves( ( ( struct leaf_task * ) task )->t );
+}
+
+/**
+ * hash_node - combine two digests into their parent
+ * @left: digest of the left child
+ * @right: digest of the right child
+ * @md: output parent digest, may be the same as left
+ */
+
+static void hash_node( const uint8_t *left, const uint8_t *right, uint8_t *md )
+{
+	uint8_t msg[ 1 + 2 * 32 ];
+
+	msg[ 0 ] = NODE_PREFIX;
+	memcpy( &msg[ 1 ], left, 32 );
+	memcpy( &msg[ 33 ], right, 32 );
+	sha256( msg, sizeof( msg ), md );
+}
+
+uint8_t *sha256_tree( const uint8_t *data, size_t len, size_t leaf_size, struct sha256_pool *pool, uint8_t *md )
+{
+	struct tree t;
+	struct leaf_task *task = NULL;
+	struct sha256_group group = { 0 };
+	size_t helpers = 0;
+
+	if ( leaf_size == 0 )
+		leaf_size = SHA256_TREE_LEAF_SIZE;
+
+	if ( pool == NULL )
+		pool = sha256_pool_default();
+
+	t.data = data;
+	t.len = len;
+	t.leaf_size = leaf_size;
+	t.leaves = len == 0 ? 1 : len / leaf_size + ( len % leaf_size != 0 );
+	t.next = 0;
+	t.md = malloc( t.leaves * 32 );
+	if ( t.md == NULL )
+		return NULL;
+
+	/*
+	 * Without a pool, or without the memory for the tasks, the calling
+	 * thread just hashes every leaf itself.
+	 */
+
+	if ( pool != NULL )
+		helpers = MIN( sha256_pool_threads( pool ), t.leaves - 1 );
+
+	if ( helpers > 0 )
+		task = malloc( helpers * sizeof( *task ) );
+
+	if ( task != NULL )
+	{
+		for ( size_t i = 0; i < helpers; i++ )
+		{
+			task[ i ].task.fn = leaf_task;
+			task[ i ].task.group = &group;
+			task[ i ].t = &t;
+			sha256_pool_submit( pool, &task[ i ].task );
+		}
+	}
+
+	hash_leaves( &t );
+
+	if ( task != NULL )
+		sha256_pool_wait( pool, &group );
+
+	free( task );
+
+	/*
+	 * Combine each level in place, the parent of nodes 2i and 2i + 1 goes to
+	 * slot i, a lone last node just moves down to its slot.
+	 */
+
+	for ( size_t n = t.leaves; n > 1; n = ( n + 1 ) / 2 )
+	{
+		for ( size_t i = 0; i < n / 2; i++ )
+			hash_node( &t.md[ 2 * i * 32 ], &t.md[ ( 2 * i + 1 ) * 32 ], &t.md[ i * 32 ] );
+
+		if ( n % 2 != 0 )
+			memmove( &t.md[ n / 2 * 32 ], &t.md[ ( n - 1 ) * 32 ], 32 );
+	}
+
+	memcpy( md, t.md, 32 );
+	free( t.md );
+
+	return md;
+}
@@ -0,0 +1,52 @@
+#ifndef SHA256_TREE_H
+#define SHA256_TREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256.h"
+#include "sha256_pool.h"
+
+/*
+ * Tree hashing. A plain sha256 digest can only be computed one block after
+ * the other, so it never uses more than one core. A tree hash splits the
+ * input into leaves that are hashed independently and then combines the
+ * leaf digests pairwise. The result is NOT the sha256 of the input, it is a
+ * different function that only agrees with itself.
+ *
+ * The format, with L the leaf size in bytes and H the plain sha256:
+ *
+ *   1. The input is cut into leaves of L bytes each. The last leaf holds
+ *      whatever is left and may be shorter. An empty input is one empty leaf.
+ *   2. Each leaf is hashed as H( 0x00 || leaf ).
+ *   3. The digests of a level are paired up in order, the digests at index
+ *      2i and 2i + 1 become H( 0x01 || left || right ) in the next level. If
+ *      a level has an odd number of digests the last one moves up to the next
+ *      level unchanged.
+ *   4. Step 3 repeats until one digest is left, which is the root. An input
+ *      of a single leaf has H( 0x00 || input ) as its root.
+ *
+ * The prefix bytes keep a leaf from ever hashing to the same value as an
+ * internal node. The leaf size isn't part of the root, whoever checks a root
+ * needs to use the same L it was made with.
+ */
+
+#define SHA256_TREE_LEAF_SIZE	( ( size_t ) 1 << 20 )
+
+/**
+ * sha256_tree - produce the tree hash of data
+ * @data: input data
+ * @len: length of data in number of bytes
+ * @leaf_size: leaf size in number of bytes, 0 for SHA256_TREE_LEAF_SIZE
+ * @pool: pool to hash the leaves on, NULL for sha256_pool_default
+ * @md: output root digest of length 256 bits that needs to be provided by caller
+ *
+ * The calling thread hashes leaves along with the pool's workers. The root
+ * only depends on data and leaf_size, not on the number of threads.
+ *
+ * Return: pointer to the root digest, or NULL if memory ran out
+ */
+
+uint8_t *sha256_tree( const uint8_t *data, size_t len, size_t leaf_size, struct sha256_pool *pool, uint8_t *md );
+
+#endif
@@ -0,0 +1,588 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "sha256_uring.h"
+#include "sha256_file.h"
+#include "sha256_internal.h"
+
+#if defined( __linux__ ) && defined( __has_include )
+#if __has_include( <linux/io_uring.h> )
+#define SHA256_URING 1
+#endif
+#endif
+
+#if defined( SHA256_URING )
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+/*
+ * There is no liburing dependency, the ring is set up and driven with the
+ * three raw system calls.
+ *
+ * Every buffer is in one of three states: free, reading, or read but waiting
+ * for an earlier buffer of the same file to be hashed first. A file's hashed
+ * offset says which buffer is next, whenever a read completes all buffers of
+ * that file that are next in line are fed to its context. Each buffer has at
+ * most one read in flight, so the submission queue, sized to the number of
+ * buffers, never overflows.
+ */
+
+struct buffer
+{
+	uint8_t *p;
+	size_t file;
+	off_t off;
+	size_t len;
+	size_t got;
+	int state;
+};
+
+#define BUF_FREE	0
+#define BUF_READING	1
+#define BUF_READ	2
+
+struct sha256_uring
+{
+	int fd;
+	unsigned depth;
+	size_t buf_size;
+
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+	unsigned queued;
+	int broken;
+
+	void *sq_map;
+	size_t sq_map_len;
+	void *cq_map;
+	size_t cq_map_len;
+	size_t sqes_len;
+
+	uint8_t *mem;
+	struct buffer *buf;
+};
+
+struct file
+{
+	int fd;
+	off_t next;
+	off_t hashed;
+	off_t end;
+	unsigned reading;
+	int err;
+	int done;
+	struct sha256_ctx ctx;
+};
+
+static int ring_setup( struct sha256_uring *r )
+{
+	struct io_uring_params p = { 0 };
+	void *sqes;
+
+	r->fd = ( int ) syscall( __NR_io_uring_setup, r->depth, &p );
+	if ( r->fd < 0 )
+		return -1;
+
+	r->sq_map_len = p.sq_off.array + p.sq_entries * sizeof( unsigned );
+	r->cq_map_len = p.cq_off.cqes + p.cq_entries * sizeof( struct io_uring_cqe );
+
+	if ( p.features & IORING_FEAT_SINGLE_MMAP )
+		r->sq_map_len = r->cq_map_len = MAX( r->sq_map_len, r->cq_map_len );
+
+	r->sq_map = mmap( NULL, r->sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING );
+	if ( r->sq_map == MAP_FAILED )
+		return -1;
+
+	if ( p.features & IORING_FEAT_SINGLE_MMAP )
+	{
+		r->cq_map = r->sq_map;
+	}
+	else
+	{
+		r->cq_map = mmap( NULL, r->cq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING );
+		if ( r->cq_map == MAP_FAILED )
+			return -1;
+	}
+
+	r->sqes_len = p.sq_entries * sizeof( struct io_uring_sqe );
+	sqes = mmap( NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES );
+	if ( sqes == MAP_FAILED )
+		return -1;
+
+	r->sqes = sqes;
+	r->sq_head = ( unsigned * ) ( ( uint8_t * ) r->sq_map + p.sq_off.head );
+	r->sq_tail = ( unsigned * ) ( ( uint8_t * ) r->sq_map + p.sq_off.tail );
+	r->sq_mask = ( unsigned * ) ( ( uint8_t * ) r->sq_map + p.sq_off.ring_mask );
+	r->sq_array = ( unsigned * ) ( ( uint8_t * ) r->sq_map + p.sq_off.array );
+	r->cq_head = ( unsigned * ) ( ( uint8_t * ) r->cq_map + p.cq_off.head );
+	r->cq_tail = ( unsigned * ) ( ( uint8_t * ) r->cq_map + p.cq_off.tail );
+	r->cq_mask = ( unsigned * ) ( ( uint8_t * ) r->cq_map + p.cq_off.ring_mask );
+	r->cqes = ( struct io_uring_cqe * ) ( ( uint8_t * ) r->cq_map + p.cq_off.cqes );
+
+	return 0;
+}
+
+struct sha256_uring *sha256_uring_create( unsigned depth, size_t buf_size )
+{
+	struct sha256_uring *r = calloc( 1, sizeof( *r ) );
+	long page = sysconf( _SC_PAGESIZE );
+	struct iovec *iov;
+	int err;
+
+	if ( r == NULL )
+		return NULL;
+
+	if ( page <= 0 )
+		page = 4096;
+
+	r->fd = -1;
+	r->depth = depth > 0 ? depth : SHA256_URING_DEPTH;
+	r->buf_size = buf_size > 0 ? buf_size : SHA256_URING_BUF_SIZE;
+	r->buf_size = ( r->buf_size + ( size_t ) page - 1 ) / ( size_t ) page * ( size_t ) page;
+
+	if ( ring_setup( r ) != 0 )
+		goto fail;
+
+	r->buf = calloc( r->depth, sizeof( *r->buf ) );
+	iov = calloc( r->depth, sizeof( *iov ) );
+	if ( r->buf == NULL || iov == NULL || posix_memalign( ( void ** ) &r->mem, ( size_t ) page, r->depth * r->buf_size ) != 0 )
+	{
+		free( iov );
+		errno = ENOMEM;
+		goto fail;
+	}
+
+	for ( unsigned i = 0; i < r->depth; i++ )
+	{
+		r->buf[ i ].p = &r->mem[ i * r->buf_size ];
+		iov[ i ].iov_base = r->buf[ i ].p;
+		iov[ i ].iov_len = r->buf_size;
+	}
+
+	/*
+	 * Registered buffers are pinned once here, instead of on every read.
+	 */
+
+	err = ( int ) syscall( __NR_io_uring_register, r->fd, IORING_REGISTER_BUFFERS, iov, r->depth );
+	free( iov );
+	if ( err < 0 )
+		goto fail;
+
+	return r;
+
+fail:
+	err = errno;
+	sha256_uring_destroy( r );
+	errno = err;
+
+	return NULL;
+}
+
+void sha256_uring_destroy( struct sha256_uring *r )
+{
+	if ( r == NULL )
+		return;
+
+	if ( r->sqes != NULL )
+		munmap( r->sqes, r->sqes_len );
+	if ( r->cq_map != NULL && r->cq_map != MAP_FAILED && r->cq_map != r->sq_map )
+		munmap( r->cq_map, r->cq_map_len );
+	if ( r->sq_map != NULL && r->sq_map != MAP_FAILED )
+		munmap( r->sq_map, r->sq_map_len );
+	if ( r->fd >= 0 )
+		close( r->fd );
+
+	free( r->mem );
+	free( r->buf );
+	free( r );
+}
+
+/**
+ * queue_read - queue a read of the rest of a buffer
+ * @r: reader
+ * @files: files being hashed
+ * @b: buffer index
+ */
+
+static void queue_read( struct sha256_uring *r, struct file *files, unsigned b )
+{
+	struct buffer *buf = &r->buf[ b ];
+	unsigned tail = *r->sq_tail;
+	unsigned idx = tail & *r->sq_mask;
+	struct io_uring_sqe *sqe = &r->sqes[ idx ];
+
+	memset( sqe, 0, sizeof( *sqe ) );
+	sqe->opcode = IORING_OP_READ_FIXED;
+	sqe->fd = files[ buf->file ].fd;
+	sqe->off = ( uint64_t ) ( buf->off + ( off_t ) buf->got );
+	sqe->addr = ( uint64_t ) ( uintptr_t ) &buf->p[ buf->got ];
+	sqe->len = ( uint32_t ) ( buf->len - buf->got );
+	sqe->buf_index = ( uint16_t ) b;
+	sqe->user_data = b;
+
+	r->sq_array[ idx ] = idx;
+	__atomic_store_n( r->sq_tail, tail + 1, __ATOMIC_RELEASE );
+
+	buf->state = BUF_READING;
+	r->queued++;
+}
+
+/**
+ * ring_drain - wait out every read still in flight after an error
+ * @r: reader
+ *
+ * Entries the kernel hasn't taken off the submission queue yet are taken
+ * back, without SQPOLL it only looks at the queue inside io_uring_enter. Every
+ * read it did take is waited for and its completion thrown away, only then
+ * can the buffers be handed out again.
+ *
+ * Return: 0 once the ring is idle, -1 if it couldn't be waited on
+ */
+
+static int ring_drain( struct sha256_uring *r )
+{
+	unsigned head = __atomic_load_n( r->sq_head, __ATOMIC_ACQUIRE );
+	unsigned inflight = 0;
+
+	for ( unsigned b = 0; b < r->depth; b++ )
+		inflight += r->buf[ b ].state == BUF_READING;
+
+	inflight -= MIN( *r->sq_tail - head, inflight );
+	__atomic_store_n( r->sq_tail, head, __ATOMIC_RELEASE );
+	r->queued = 0;
+
+	for ( ;; )
+	{
+		unsigned cq_head = *r->cq_head;
+		unsigned cq_tail = __atomic_load_n( r->cq_tail, __ATOMIC_ACQUIRE );
+
+		inflight -= MIN( cq_tail - cq_head, inflight );
+		__atomic_store_n( r->cq_head, cq_tail, __ATOMIC_RELEASE );
+
+		if ( inflight == 0 )
+			break;
+
+		if ( syscall( __NR_io_uring_enter, r->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0 ) < 0 && errno != EINTR )
+			return -1;
+	}
+
+	for ( unsigned b = 0; b < r->depth; b++ )
+		r->buf[ b ].state = BUF_FREE;
+
+	return 0;
+}
+
+/**
+ * file_drain - hash the buffers of a file that are next in line
+ * @r: reader
+ * @f: the file
+ * @i: index of the file
+ * @md: output digest of the file
+ *
+ * Return: number of buffers freed
+ */
+
+static unsigned file_drain( struct sha256_uring *r, struct file *f, size_t i, uint8_t *md )
+{
+	unsigned freed = 0;
+	int progress = 1;
+
+	while ( progress )
+	{
+		progress = 0;
+
+		for ( unsigned b = 0; b < r->depth; b++ )
+		{
+			struct buffer *buf = &r->buf[ b ];
+
+			if ( buf->state != BUF_READ || buf->file != i )
+				continue;
+
+			if ( f->err == 0 && buf->off != f->hashed )
+				continue;
+
+			if ( f->err == 0 )
+			{
+				sha256_update( &f->ctx, buf->p, buf->len );
+				f->hashed += ( off_t ) buf->len;
+				progress = 1;
+			}
+
+			buf->state = BUF_FREE;
+			f->reading--;
+			freed++;
+		}
+	}
+
+	if ( f->reading == 0 && ( f->err != 0 || f->hashed == f->end ) )
+	{
+		f->done = 1;
+
+		if ( f->err == 0 )
+		{
+			sha256_final( &f->ctx, md );
+			if ( lseek( f->fd, f->end, SEEK_SET ) < 0 )
+				f->err = errno;
+		}
+	}
+
+	return freed;
+}
+
+/**
+ * file_start - get a file ready to be read through the ring
+ * @f: file
+ * @fd: its descriptor
+ * @md: output digest, for files that are done right away
+ */
+
+static void file_start( struct file *f, int fd, uint8_t *md )
+{
+	struct stat st;
+
+	f->fd = fd;
+	f->reading = 0;
+	f->err = 0;
+	f->done = 0;
+	sha256_init( &f->ctx );
+
+	if ( fstat( fd, &st ) < 0 )
+	{
+		f->err = errno;
+		f->done = 1;
+		return;
+	}
+
+	/*
+	 * Pipes and the like can only be read in order, nothing to gain from the
+	 * ring there.
+	 */
+
+	if ( !S_ISREG( st.st_mode ) || ( f->next = lseek( fd, 0, SEEK_CUR ) ) < 0 )
+	{
+		f->err = sha256_fd( fd, md ) == NULL ? errno : 0;
+		f->done = 1;
+		return;
+	}
+
+	f->hashed = f->next;
+	f->end = MAX( st.st_size, f->next );
+
+	if ( f->next == f->end )
+	{
+		sha256_final( &f->ctx, md );
+		f->done = 1;
+	}
+}
+
+int sha256_uring_files( struct sha256_uring *r, const int *fd, uint8_t *md, int *err, size_t n )
+{
+	struct file *files;
+	size_t cur = 0;
+	unsigned busy = 0;
+	int ret = 0;
+
+	if ( r == NULL || r->broken )
+	{
+		for ( size_t i = 0; i < n; i++ )
+		{
+			err[ i ] = sha256_fd( fd[ i ], &md[ i * 32 ] ) == NULL ? errno : 0;
+			ret |= err[ i ] != 0 ? -1 : 0;
+		}
+
+		return ret;
+	}
+
+	files = calloc( n, sizeof( *files ) );
+	if ( files == NULL )
+	{
+		for ( size_t i = 0; i < n; i++ )
+			err[ i ] = ENOMEM;
+		return -1;
+	}
+
+	if ( n > 0 )
+		file_start( &files[ 0 ], fd[ 0 ], &md[ 0 ] );
+
+	for ( ;; )
+	{
+		unsigned head, tail;
+		int res;
+
+		/*
+		 * Hand every free buffer the next piece of the oldest file that
+		 * hasn't been asked for in full yet.
+		 */
+
+		for ( unsigned b = 0; b < r->depth; b++ )
+		{
+			struct buffer *buf = &r->buf[ b ];
+			struct file *f;
+
+			if ( buf->state != BUF_FREE )
+				continue;
+
+			while ( cur < n && ( files[ cur ].done || files[ cur ].err != 0 || files[ cur ].next == files[ cur ].end ) )
+			{
+				if ( ++cur < n )
+					file_start( &files[ cur ], fd[ cur ], &md[ cur * 32 ] );
+			}
+
+			if ( cur == n )
+				break;
+
+			f = &files[ cur ];
+			buf->file = cur;
+			buf->off = f->next;
+			buf->len = ( size_t ) MIN( ( off_t ) r->buf_size, f->end - f->next );
+			buf->got = 0;
+			f->next += ( off_t ) buf->len;
+			f->reading++;
+			busy++;
+			queue_read( r, files, b );
+		}
+
+		if ( busy == 0 )
+			break;
+
+		res = ( int ) syscall( __NR_io_uring_enter, r->fd, r->queued, 1, IORING_ENTER_GETEVENTS, NULL, 0 );
+		if ( res < 0 && errno == EINTR )
+			continue;
+
+		if ( res < 0 )
+		{
+			int e = errno;
+
+			/*
+			 * The ring itself failed, fail whatever isn't done yet. Reads
+			 * already in flight still land in the buffers, so the ring is
+			 * only used again once they're all back. Otherwise it's given
+			 * up on and later calls go through sha256_fd.
+			 */
+
+			for ( size_t i = 0; i < n; i++ )
+			{
+				if ( !files[ i ].done )
+					files[ i ].err = e;
+			}
+
+			if ( ring_drain( r ) != 0 )
+				r->broken = 1;
+
+			break;
+		}
+
+		r->queued -= MIN( ( unsigned ) res, r->queued );
+
+		head = *r->cq_head;
+		tail = __atomic_load_n( r->cq_tail, __ATOMIC_ACQUIRE );
+
+		for ( ; head != tail; head++ )
+		{
+			struct io_uring_cqe *cqe = &r->cqes[ head & *r->cq_mask ];
+			unsigned b = ( unsigned ) cqe->user_data;
+			struct buffer *buf = &r->buf[ b ];
+			struct file *f = &files[ buf->file ];
+
+			if ( cqe->res == -EINTR || cqe->res == -EAGAIN )
+			{
+				queue_read( r, files, b );
+				continue;
+			}
+
+			if ( cqe->res < 0 )
+				f->err = -cqe->res;
+			else if ( cqe->res == 0 )
+				f->err = EIO;
+			else
+				buf->got += ( size_t ) cqe->res;
+
+			/*
+			 * A short read just asks again for the rest of the buffer, that
+			 * way buffers still line up with file offsets.
+			 */
+
+			if ( f->err == 0 && buf->got < buf->len )
+			{
+				queue_read( r, files, b );
+				continue;
+			}
+
+			buf->state = BUF_READ;
+			busy -= file_drain( r, f, buf->file, &md[ buf->file * 32 ] );
+		}
+
+		__atomic_store_n( r->cq_head, head, __ATOMIC_RELEASE );
+	}
+
+	for ( size_t i = 0; i < n; i++ )
+	{
+		err[ i ] = files[ i ].err;
+		ret |= err[ i ] != 0 ? -1 : 0;
+	}
+
+	free( files );
+
+	return ret;
+}
+
+#else
+
+struct sha256_uring *sha256_uring_create( unsigned depth, size_t buf_size )
+{
+	( void ) depth;
+	( void ) buf_size;
+
+	errno = ENOSYS;
+
+	return NULL;
+}
+
+void sha256_uring_destroy( struct sha256_uring *r )
+{
+	( void ) r;
+}
+
+int sha256_uring_files( struct sha256_uring *r, const int *fd, uint8_t *md, int *err, size_t n )
+{
+	int ret = 0;
+
+	( void ) r;
+
+	for ( size_t i = 0; i < n; i++ )
+	{
+		err[ i ] = sha256_fd( fd[ i ], &md[ i * 32 ] ) == NULL ? errno : 0;
+		ret |= err[ i ] != 0 ? -1 : 0;
+	}
+
+	return ret;
+}
+
+#endif
+
+uint8_t *sha256_uring_fd( struct sha256_uring *r, int fd, uint8_t *md )
+{
+	int err;
+
+	if ( sha256_uring_files( r, &fd, md, &err, 1 ) != 0 )
+	{
+		errno = err;
+		return NULL;
+	}
+
+	return md;
+}
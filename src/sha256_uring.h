@@ -0,0 +1,82 @@
+#ifndef SHA256_URING_H
+#define SHA256_URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sha256.h"
+
+/*
+ * File hashing on top of io_uring. A reader keeps a fixed number of
+ * registered buffers in flight, so the device always has reads queued while
+ * the cpu hashes the buffers that already came back. Reads complete in any
+ * order but are hashed in file order.
+ *
+ * On kernels without io_uring, or where it is disabled, sha256_uring_create
+ * fails and every hashing function here accepts a NULL reader and falls back
+ * to sha256_fd.
+ *
+ * A reader must only be used by one thread at a time.
+ */
+
+struct sha256_uring;
+
+#define SHA256_URING_DEPTH		16
+#define SHA256_URING_BUF_SIZE	( ( size_t ) 256 * 1024 )
+
+/**
+ * sha256_uring_create - set up a ring and its buffers
+ * @depth: number of reads in flight, 0 for SHA256_URING_DEPTH
+ * @buf_size: size of each read in bytes, 0 for SHA256_URING_BUF_SIZE
+ *
+ * buf_size is rounded up to a multiple of the page size.
+ *
+ * Return: the reader, or NULL with errno set, ENOSYS if the kernel has no
+ * io_uring
+ */
+
+struct sha256_uring *sha256_uring_create( unsigned depth, size_t buf_size );
+
+/**
+ * sha256_uring_destroy - tear down a reader
+ * @r: reader, may be NULL
+ */
+
+void sha256_uring_destroy( struct sha256_uring *r );
+
+/**
+ * sha256_uring_fd - hash everything left in an open file
+ * @r: reader, or NULL to use sha256_fd
+ * @fd: file descriptor open for reading
+ * @md: output message digest of length 256 bits that needs to be provided by caller
+ *
+ * Same as sha256_fd, except that regular files are read through the ring.
+ *
+ * Return: pointer to the message digest, or NULL with errno set on error
+ */
+
+uint8_t *sha256_uring_fd( struct sha256_uring *r, int fd, uint8_t *md );
+
+/**
+ * sha256_uring_files - hash many open files at once
+ * @r: reader, or NULL to use sha256_fd on each file
+ * @fd: array of n file descriptors open for reading
+ * @md: output, n message digests of 32 bytes each, back to back
+ * @err: output, n errno values, 0 for each file that was hashed
+ * @n: number of files
+ *
+ * The reads of consecutive files overlap, as soon as all of one file has been
+ * asked for, free buffers go to the next one. That keeps the queue full on
+ * directories of small and medium files too, which a single file at a time
+ * couldn't. Each file is hashed from its current offset to its end.
+ *
+ * If the ring itself fails, every file not done yet fails with its errno. A
+ * ring that can't be brought back to idle after that is never used again,
+ * later calls on it go through sha256_fd.
+ *
+ * Return: 0 if every file was hashed, -1 if at least one failed
+ */
+
+int sha256_uring_files( struct sha256_uring *r, const int *fd, uint8_t *md, int *err, size_t n );
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sha256.h"
+#include "sha256_mb.h"
+
+/*
+ * Shared by the tests, one per feature, each run under every kernel the cpu
+ * has.
+ *
+ * Digests are checked against a plain implementation of FIPS 180-4 below,
+ * which is itself checked against the published vectors first. Lengths
+ * around the padding boundaries get the most attention: 55 is the longest
+ * message whose padding fits in its last block, 56 the shortest that needs
+ * another one, and 63, 64, 119 and 120 are the same edges a block later.
+ */
+
+#define MAX_LEN	( 3 * 4096 )
+
+static const char *kernels[] = { "shani", "avx2", "ssse3", "scalar-bmi2", "scalar" };
+static const char *mb_kernels[] = { "avx512", "shani-x2", "avx2", "serial" };
+
+static const size_t edges[] = { 0, 1, 3, 31, 32, 33, 55, 56, 57, 63, 64, 65, 119, 120, 121, 127, 128, 129, 1000, 4096, 8191 };
+
+#define EDGES ( sizeof( edges ) / sizeof( edges[ 0 ] ) )
+
+static uint8_t msg[ MAX_LEN + 64 ];
+static unsigned checks;
+static unsigned failures;
+static const char *kernel = "";
+
+/*
+ * Reference implementation, one byte at a time.
+ */
+
+static const uint32_t ref_K[ 64 ] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROR( x, n ) ( ( ( x ) >> ( n ) ) | ( ( x ) << ( 32 - ( n ) ) ) )
+
+static inline void ref_block( uint32_t *H, const uint8_t *p )
+{
+	uint32_t W[ 64 ];
+	uint32_t v[ 8 ];
+
+	for ( int t = 0; t < 16; t++ )
+		W[ t ] = ( uint32_t ) p[ t * 4 ] << 24 | ( uint32_t ) p[ t * 4 + 1 ] << 16 | ( uint32_t ) p[ t * 4 + 2 ] << 8 | p[ t * 4 + 3 ];
+
+	for ( int t = 16; t < 64; t++ )
+	{
+		uint32_t s0 = ROR( W[ t - 15 ], 7 ) ^ ROR( W[ t - 15 ], 18 ) ^ ( W[ t - 15 ] >> 3 );
+		uint32_t s1 = ROR( W[ t - 2 ], 17 ) ^ ROR( W[ t - 2 ], 19 ) ^ ( W[ t - 2 ] >> 10 );
+
+		W[ t ] = W[ t - 16 ] + s0 + W[ t - 7 ] + s1;
+	}
+
+	memcpy( v, H, sizeof( v ) );
+
+	for ( int t = 0; t < 64; t++ )
+	{
+		uint32_t S1 = ROR( v[ 4 ], 6 ) ^ ROR( v[ 4 ], 11 ) ^ ROR( v[ 4 ], 25 );
+		uint32_t ch = ( v[ 4 ] & v[ 5 ] ) ^ ( ~v[ 4 ] & v[ 6 ] );
+		uint32_t T1 = v[ 7 ] + S1 + ch + ref_K[ t ] + W[ t ];
+		uint32_t S0 = ROR( v[ 0 ], 2 ) ^ ROR( v[ 0 ], 13 ) ^ ROR( v[ 0 ], 22 );
+		uint32_t maj = ( v[ 0 ] & v[ 1 ] ) ^ ( v[ 0 ] & v[ 2 ] ) ^ ( v[ 1 ] & v[ 2 ] );
+
+		memmove( &v[ 1 ], &v[ 0 ], 7 * sizeof( v[ 0 ] ) );
+		v[ 4 ] += T1;
+		v[ 0 ] = T1 + S0 + maj;
+	}
+
+	for ( int i = 0; i < 8; i++ )
+		H[ i ] += v[ i ];
+}
+
+static inline void ref_sha256( const uint8_t *data, size_t len, uint8_t *md )
+{
+	uint32_t H[ 8 ] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+	uint8_t blk[ 128 ];
+	size_t full = len & ~( size_t ) 63;
+	size_t tail = len - full;
+	size_t pad = tail < 56 ? 64 : 128;
+
+	for ( size_t i = 0; i < full; i += 64 )
+		ref_block( H, &data[ i ] );
+
+	memset( blk, 0, sizeof( blk ) );
+	memcpy( blk, &data[ full ], tail );
+	blk[ tail ] = 0x80;
+
+	for ( int i = 0; i < 8; i++ )
+		blk[ pad - 1 - i ] = ( uint8_t ) ( ( ( uint64_t ) len * 8 ) >> ( 8 * i ) );
+
+	for ( size_t i = 0; i < pad; i += 64 )
+		ref_block( H, &blk[ i ] );
+
+	for ( int i = 0; i < 32; i++ )
+		md[ i ] = ( uint8_t ) ( H[ i / 4 ] >> ( 24 - 8 * ( i % 4 ) ) );
+}
+
+/*
+ * Checking
+ */
+
+static inline void hex( const uint8_t *p, size_t len, char *out )
+{
+	for ( size_t i = 0; i < len; i++ )
+		sprintf( &out[ i * 2 ], "%02x", p[ i ] );
+}
+
+static inline void unhex( const char *s, uint8_t *out )
+{
+	for ( size_t i = 0; s[ i * 2 ] != '\0'; i++ )
+		sscanf( &s[ i * 2 ], "%2hhx", &out[ i ] );
+}
+
+/**
+ * check - compare a result with the expected bytes
+ * @what: name of the entry point under test
+ * @len: message length, reported on failure
+ * @got: bytes produced
+ * @want: bytes expected
+ * @size: number of bytes to compare
+ */
+
+static inline void check( const char *what, size_t len, const uint8_t *got, const uint8_t *want, size_t size )
+{
+	char g[ 129 ], w[ 129 ];
+
+	checks++;
+
+	if ( memcmp( got, want, size ) == 0 )
+		return;
+
+	failures++;
+	hex( got, size, g );
+	hex( want, size, w );
+	fprintf( stderr, "FAIL %s [%s] len %zu\n  got  %s\n  want %s\n", what, kernel, len, g, w );
+}
+
+static inline void check_hex( const char *what, size_t len, const uint8_t *got, const char *want )
+{
+	uint8_t w[ 64 ];
+
+	unhex( want, w );
+	check( what, len, got, w, strlen( want ) / 2 );
+}
+
+/**
+ * check_true - count a check that isn't a comparison of bytes
+ * @what: what went wrong if it failed
+ * @ok: whether it passed
+ */
+
+static inline void check_true( const char *what, int ok )
+{
+	checks++;
+
+	if ( ok )
+		return;
+
+	failures++;
+	fprintf( stderr, "FAIL %s [%s]\n", what, kernel );
+}
+
+/*
+ * Running
+ */
+
+/**
+ * test_init - fill the message every test draws its inputs from
+ */
+
+static inline void test_init( void )
+{
+	uint32_t x = 0x12345678;
+
+	for ( size_t i = 0; i < sizeof( msg ); i++ )
+	{
+		x = x * 1103515245 + 12345;
+		msg[ i ] = ( uint8_t ) ( x >> 16 );
+	}
+
+	/* avx512 is only picked for big batches otherwise */
+
+	sha256_set_avx512_min_batch( 0 );
+}
+
+/**
+ * run_kernels - run a test under every single-buffer kernel the cpu has
+ * @fn: the test
+ */
+
+static inline void run_kernels( void ( *fn )( void ) )
+{
+	for ( size_t i = 0; i < sizeof( kernels ) / sizeof( kernels[ 0 ] ); i++ )
+	{
+		unsigned before = failures;
+
+		kernel = kernels[ i ];
+
+		if ( sha256_set_kernel( kernel ) != 0 )
+		{
+			printf( "  SKIP   kernel %s\n", kernel );
+			continue;
+		}
+
+		fn();
+		printf( "  %s   kernel %s\n", failures == before ? "PASS" : "FAIL", kernel );
+	}
+
+	sha256_set_kernel( NULL );
+}
+
+/**
+ * run_mb_kernels - run a test under every multi-buffer kernel the cpu has
+ * @fn: the test
+ */
+
+static inline void run_mb_kernels( void ( *fn )( void ) )
+{
+	for ( size_t i = 0; i < sizeof( mb_kernels ) / sizeof( mb_kernels[ 0 ] ); i++ )
+	{
+		unsigned before = failures;
+
+		kernel = mb_kernels[ i ];
+
+		if ( sha256_set_mb_kernel( kernel ) != 0 )
+		{
+			printf( "  SKIP   mb kernel %s\n", kernel );
+			continue;
+		}
+
+		fn();
+		printf( "  %s   mb kernel %s\n", failures == before ? "PASS" : "FAIL", kernel );
+	}
+
+	sha256_set_mb_kernel( NULL );
+}
+
+/**
+ * test_done - report the tally
+ *
+ * Return: exit status of the test
+ */
+
+static inline int test_done( void )
+{
+	printf( "  %u checks, %u failures\n", checks, failures );
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#include "test.h"
+
+/*
+ * sha256_batch, messages of any length, under every multi-buffer kernel.
+ */
+
+static void test_batch( void )
+{
+	static const size_t counts[] = { 1, 2, 3, 7, 8, 9, 16, 17, 33 };
+	const uint8_t *data[ 33 ];
+	size_t len[ 33 ];
+	uint8_t md[ 33 * SHA256_DIGEST_SIZE ], want[ SHA256_DIGEST_SIZE ];
+
+	for ( size_t c = 0; c < sizeof( counts ) / sizeof( counts[ 0 ] ); c++ )
+	{
+		size_t n = counts[ c ];
+
+		/* lanes of different lengths, so some go idle before others */
+
+		for ( size_t i = 0; i < n; i++ )
+		{
+			data[ i ] = &msg[ i % 5 ];
+			len[ i ] = edges[ ( i * 7 + c ) % EDGES ];
+		}
+
+		sha256_batch( data, len, md, n );
+
+		for ( size_t i = 0; i < n; i++ )
+		{
+			ref_sha256( data[ i ], len[ i ], want );
+			check( "sha256_batch", len[ i ], &md[ i * 32 ], want, sizeof( want ) );
+		}
+	}
+}
+
+int main( void )
+{
+	test_init();
+	run_mb_kernels( test_batch );
+
+	return test_done();
+}
@@ -0,0 +1,38 @@
+#include "test.h"
+
+/*
+ * sha256_chain, hashes of hashes, under every multi-buffer kernel.
+ */
+
+static void test_chain( void )
+{
+	static const uint64_t iters[] = { 0, 1, 2, 17 };
+	uint8_t md[ 19 * 32 ], want[ 32 ];
+
+	for ( size_t t = 0; t < sizeof( iters ) / sizeof( iters[ 0 ] ); t++ )
+	{
+		for ( size_t n = 1; n <= 19; n += 9 )
+		{
+			memcpy( md, msg, n * 32 );
+			sha256_chain( md, n, iters[ t ] );
+
+			for ( size_t i = 0; i < n; i++ )
+			{
+				memcpy( want, &msg[ i * 32 ], 32 );
+
+				for ( uint64_t k = 0; k < iters[ t ]; k++ )
+					ref_sha256( want, 32, want );
+
+				check( "sha256_chain", 32, &md[ i * 32 ], want, sizeof( want ) );
+			}
+		}
+	}
+}
+
+int main( void )
+{
+	test_init();
+	run_mb_kernels( test_chain );
+
+	return test_done();
+}
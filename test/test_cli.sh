@@ -0,0 +1,36 @@
+#!/bin/sh
+#
+# Command line tests. Takes the path of the binary to run.
+#
+# Every "-" argument reads the same standard input, so only the first one may
+# see its data, the others get whatever is left, which is nothing. Files
+# around them are hashed on the pool and must not change that.
+
+bin=${1:-build/bin/main}
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+fail=0
+
+abc=ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad
+x=2d711642b726b04401627ca9fbac32f5c8530fb1903cc4db02258717921a4881
+empty=e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855
+
+printf x > "$dir/x"
+
+printf '%s  -\n%s  %s\n%s  -\n%s  %s\n%s  -\n' \
+	"$abc" "$x" "$dir/x" "$empty" "$x" "$dir/x" "$empty" > "$dir/want"
+
+for io in mmap direct nocache uring; do
+	for jobs in 1 4; do
+		printf abc | "$bin" --io=$io -j $jobs - "$dir/x" - "$dir/x" - > "$dir/got" 2>&1
+
+		if ! cmp -s "$dir/got" "$dir/want"; then
+			echo "FAIL stdin given more than once, --io=$io -j $jobs"
+			diff "$dir/want" "$dir/got"
+			fail=1
+		fi
+	done
+done
+
+[ $fail = 0 ] && echo "  PASS   command line"
+exit $fail
@@ -0,0 +1,43 @@
+#include "test.h"
+
+/*
+ * sha256d64, the double hash of 64 byte messages, under every multi-buffer
+ * kernel.
+ */
+
+static void test_d64( void )
+{
+	uint8_t out[ 21 * 32 ], buf[ 21 * 64 ], tmp[ 32 ], want[ 32 ];
+
+	for ( size_t n = 0; n <= 21; n++ )
+	{
+		sha256d64( out, msg, n );
+
+		for ( size_t i = 0; i < n; i++ )
+		{
+			ref_sha256( &msg[ i * 64 ], 64, tmp );
+			ref_sha256( tmp, 32, want );
+			check( "sha256d64", 64, &out[ i * 32 ], want, sizeof( want ) );
+		}
+	}
+
+	/* in place, the output over the start of the input */
+
+	memcpy( buf, msg, sizeof( buf ) );
+	sha256d64( buf, buf, 21 );
+
+	for ( size_t i = 0; i < 21; i++ )
+	{
+		ref_sha256( &msg[ i * 64 ], 64, tmp );
+		ref_sha256( tmp, 32, want );
+		check( "sha256d64 in place", 64, &buf[ i * 32 ], want, sizeof( want ) );
+	}
+}
+
+int main( void )
+{
+	test_init();
+	run_mb_kernels( test_d64 );
+
+	return test_done();
+}
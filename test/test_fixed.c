@@ -0,0 +1,40 @@
+#include "test.h"
+
+/*
+ * The fixed length batches, under every multi-buffer kernel.
+ */
+
+static void test_fixed( void )
+{
+	static const size_t sizes[] = { 32, 64, 4096, 8192 };
+	static void ( *const fn[] )( const uint8_t *const *, uint8_t *, size_t ) = {
+		sha256_batch_32, sha256_batch_64, sha256_batch_4096, sha256_batch_8192
+	};
+	const uint8_t *data[ 19 ];
+	uint8_t md[ 19 * SHA256_DIGEST_SIZE ], want[ SHA256_DIGEST_SIZE ];
+
+	for ( size_t f = 0; f < 4; f++ )
+	{
+		for ( size_t n = 1; n <= 19; n += 6 )
+		{
+			for ( size_t i = 0; i < n; i++ )
+				data[ i ] = &msg[ ( i * 13 ) % ( MAX_LEN - sizes[ f ] ) ];
+
+			fn[ f ]( data, md, n );
+
+			for ( size_t i = 0; i < n; i++ )
+			{
+				ref_sha256( data[ i ], sizes[ f ], want );
+				check( "sha256_batch_fixed", sizes[ f ], &md[ i * 32 ], want, sizeof( want ) );
+			}
+		}
+	}
+}
+
+int main( void )
+{
+	test_init();
+	run_mb_kernels( test_fixed );
+
+	return test_done();
+}
@@ -0,0 +1,75 @@
+#include "sha256_hmac.h"
+
+#include "test.h"
+
+/*
+ * HMAC against the RFC 4231 vectors, one at a time and batched, under every
+ * multi-buffer kernel.
+ */
+
+static void test_hmac( void )
+{
+	static const struct
+	{
+		uint8_t key_byte;
+		size_t key_len;
+		const char *msg;
+		const char *mac;
+	} rfc4231[] = {
+		{ 0x0b, 20, "Hi There", "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7" },
+		{ 0, 0, "what do ya want for nothing?", "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843" },
+		{ 0xaa, 131, "Test Using Larger Than Block-Size Key - Hash Key First", "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54" }
+	};
+	const struct sha256_hmac_key *keys[ 9 ];
+	const uint8_t *data[ 9 ], *tags[ 9 ];
+	struct sha256_hmac_key key[ 3 ];
+	uint8_t md[ 9 * 32 ], k[ 131 ];
+	size_t len[ 9 ];
+	int ok[ 9 ], ret;
+
+	for ( size_t i = 0; i < 3; i++ )
+	{
+		size_t klen = rfc4231[ i ].key_len;
+
+		if ( klen == 0 )
+		{
+			memcpy( k, "Jefe", 4 );
+			klen = 4;
+		}
+		else
+		{
+			memset( k, rfc4231[ i ].key_byte, klen );
+		}
+
+		sha256_hmac_key_init( &key[ i ], k, klen );
+		sha256_hmac( &key[ i ], ( const uint8_t * ) rfc4231[ i ].msg, strlen( rfc4231[ i ].msg ), md );
+		check_hex( "sha256_hmac", strlen( rfc4231[ i ].msg ), md, rfc4231[ i ].mac );
+	}
+
+	for ( size_t i = 0; i < 9; i++ )
+	{
+		keys[ i ] = &key[ i % 3 ];
+		data[ i ] = ( const uint8_t * ) rfc4231[ i % 3 ].msg;
+		len[ i ] = strlen( rfc4231[ i % 3 ].msg );
+	}
+
+	sha256_hmac_batch( keys, data, len, md, 9 );
+
+	for ( size_t i = 0; i < 9; i++ )
+	{
+		check_hex( "sha256_hmac_batch", len[ i ], &md[ i * 32 ], rfc4231[ i % 3 ].mac );
+		tags[ i ] = &md[ i * 32 ];
+	}
+
+	md[ 4 * 32 + 31 ] ^= 1;
+	ret = sha256_hmac_verify_batch( keys, data, len, tags, ok, 9 );
+	check_true( "sha256_hmac_verify_batch", ret == -1 && ok[ 4 ] == 0 && ok[ 3 ] == 1 && ok[ 5 ] == 1 );
+}
+
+int main( void )
+{
+	test_init();
+	run_mb_kernels( test_hmac );
+
+	return test_done();
+}
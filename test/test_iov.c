@@ -0,0 +1,50 @@
+#include "sha256_iov.h"
+
+#include "test.h"
+
+/*
+ * sha256_iov with segments of awkward lengths, under every single-buffer
+ * kernel.
+ */
+
+static void test_iov( void )
+{
+	uint8_t md[ SHA256_DIGEST_SIZE ], want[ SHA256_DIGEST_SIZE ];
+	struct iovec iov[ 16 ];
+
+	for ( size_t i = 0; i < EDGES; i++ )
+	{
+		size_t len = edges[ i ], off = 0;
+		int n = 0;
+
+		ref_sha256( msg, len, want );
+
+		/* segments of 0, 1, 63, 64, 65, 2, 0, ... bytes, the rest in the last one */
+
+		while ( n < 15 && off < len )
+		{
+			static const size_t seg[] = { 0, 1, 63, 64, 65, 2 };
+			size_t s = seg[ n % 6 ] < len - off ? seg[ n % 6 ] : len - off;
+
+			iov[ n ].iov_base = &msg[ off ];
+			iov[ n ].iov_len = s;
+			off += s;
+			n++;
+		}
+
+		iov[ n ].iov_base = &msg[ off ];
+		iov[ n ].iov_len = len - off;
+		n++;
+
+		sha256_iov( iov, n, md );
+		check( "sha256_iov", len, md, want, sizeof( md ) );
+	}
+}
+
+int main( void )
+{
+	test_init();
+	run_kernels( test_iov );
+
+	return test_done();
+}
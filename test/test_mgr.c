@@ -0,0 +1,77 @@
+#include "test.h"
+
+/*
+ * The job manager, with messages fed in pieces, under every multi-buffer
+ * kernel.
+ */
+
+static void test_mgr( void )
+{
+	struct sha256_job job[ 21 ];
+	uint8_t md[ 21 ][ SHA256_DIGEST_SIZE ], want[ SHA256_DIGEST_SIZE ];
+	size_t off[ 21 ], len[ 21 ];
+	struct sha256_mgr mgr;
+	struct sha256_job *done;
+	size_t left = 21;
+
+	sha256_mgr_init( &mgr );
+
+	for ( size_t i = 0; i < 21; i++ )
+	{
+		memset( &job[ i ], 0, sizeof( job[ i ] ) );
+		off[ i ] = 0;
+		len[ i ] = edges[ i % EDGES ];
+	}
+
+	/*
+	 * Every message goes in as pieces of a few odd sizes, round robin, so
+	 * jobs come back at different times and pieces straddle blocks.
+	 */
+
+	for ( size_t round = 0; left > 0; round++ )
+	{
+		for ( size_t i = 0; i < 21; i++ )
+		{
+			size_t piece = ( i + round ) % 3 == 0 ? 1 : ( i + round ) % 3 == 1 ? 63 : 130;
+
+			if ( off[ i ] > len[ i ] || job[ i ].status == SHA256_JOB_PROCESSING )
+				continue;
+
+			piece = piece < len[ i ] - off[ i ] ? piece : len[ i ] - off[ i ];
+
+			job[ i ].data = &msg[ off[ i ] ];
+			job[ i ].len = piece;
+			job[ i ].md = md[ i ];
+			job[ i ].flags = ( off[ i ] == 0 ? SHA256_JOB_FIRST : 0 ) | ( off[ i ] + piece == len[ i ] ? SHA256_JOB_LAST : 0 );
+			job[ i ].status = SHA256_JOB_PROCESSING;
+
+			/* one past the end marks a message that has had its last piece */
+
+			off[ i ] += piece + ( off[ i ] + piece == len[ i ] );
+
+			sha256_mgr_submit( &mgr, &job[ i ] );
+		}
+
+		while ( ( done = sha256_mgr_flush( &mgr ) ) != NULL )
+			;
+
+		left = 0;
+
+		for ( size_t i = 0; i < 21; i++ )
+			left += off[ i ] <= len[ i ];
+	}
+
+	for ( size_t i = 0; i < 21; i++ )
+	{
+		ref_sha256( msg, len[ i ], want );
+		check( "sha256_mgr", len[ i ], md[ i ], want, sizeof( want ) );
+	}
+}
+
+int main( void )
+{
+	test_init();
+	run_mb_kernels( test_mgr );
+
+	return test_done();
+}
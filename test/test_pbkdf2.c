@@ -0,0 +1,47 @@
+#include "sha256_pbkdf2.h"
+
+#include "test.h"
+
+/*
+ * PBKDF2 against the RFC 7914 vectors, one at a time and batched, under
+ * every multi-buffer kernel.
+ */
+
+static void test_pbkdf2( void )
+{
+	static const char *want[] = {
+		"55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783",
+		"4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56a1d425a1225833549adb841b51c9b3176a272bdebba1d078478f62b397f33c8d"
+	};
+	struct sha256_pbkdf2_req req[ 3 ];
+	uint8_t out[ 3 ][ 64 ];
+
+	/* RFC 7914 section 11 */
+
+	sha256_pbkdf2( ( const uint8_t * ) "passwd", 6, ( const uint8_t * ) "salt", 4, 1, out[ 0 ], 64 );
+	check_hex( "sha256_pbkdf2", 64, out[ 0 ], want[ 0 ] );
+
+	for ( size_t i = 0; i < 3; i++ )
+	{
+		req[ i ].pw = ( const uint8_t * ) ( i % 2 == 0 ? "passwd" : "Password" );
+		req[ i ].pw_len = i % 2 == 0 ? 6 : 8;
+		req[ i ].salt = ( const uint8_t * ) ( i % 2 == 0 ? "salt" : "NaCl" );
+		req[ i ].salt_len = 4;
+		req[ i ].iter = i % 2 == 0 ? 1 : 80000;
+		req[ i ].out = out[ i ];
+		req[ i ].out_len = i == 2 ? 40 : 64;
+	}
+
+	sha256_pbkdf2_batch( req, 3 );
+	check_hex( "sha256_pbkdf2_batch", 64, out[ 0 ], want[ 0 ] );
+	check_hex( "sha256_pbkdf2_batch", 64, out[ 1 ], want[ 1 ] );
+	check( "sha256_pbkdf2_batch", 40, out[ 2 ], out[ 0 ], 40 );
+}
+
+int main( void )
+{
+	test_init();
+	run_mb_kernels( test_pbkdf2 );
+
+	return test_done();
+}
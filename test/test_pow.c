@@ -0,0 +1,55 @@
+#include "sha256_pow.h"
+
+#include "test.h"
+
+/*
+ * The nonce search, under every multi-buffer kernel.
+ */
+
+static void test_pow( void )
+{
+	uint8_t header[ 100 ], md[ 32 ], want[ 32 ];
+	uint64_t nonce;
+	int ret;
+
+	memcpy( header, msg, sizeof( header ) );
+
+	ret = sha256_pow( header, sizeof( header ), 70, 12, 5, 1 << 20, NULL, &nonce, md );
+	check_true( "sha256_pow no nonce", ret == 0 );
+
+	if ( ret != 0 )
+		return;
+
+	for ( int i = 0; i < 8; i++ )
+		header[ 70 + i ] = ( uint8_t ) ( nonce >> ( 56 - 8 * i ) );
+
+	ref_sha256( header, sizeof( header ), want );
+	check( "sha256_pow", sizeof( header ), md, want, sizeof( want ) );
+
+	check_true( "sha256_pow digest misses the target", md[ 0 ] == 0 && ( md[ 1 ] & 0xf0 ) == 0 );
+
+	/* no nonce below the one found meets the target either */
+
+	for ( uint64_t n = 5; n < nonce; n++ )
+	{
+		for ( int i = 0; i < 8; i++ )
+			header[ 70 + i ] = ( uint8_t ) ( n >> ( 56 - 8 * i ) );
+
+		ref_sha256( header, sizeof( header ), want );
+
+		if ( want[ 0 ] == 0 && ( want[ 1 ] & 0xf0 ) == 0 )
+		{
+			failures++;
+			fprintf( stderr, "FAIL sha256_pow [%s] missed nonce %llu\n", kernel, ( unsigned long long ) n );
+			break;
+		}
+	}
+}
+
+int main( void )
+{
+	test_init();
+	run_mb_kernels( test_pow );
+
+	return test_done();
+}
@@ -0,0 +1,76 @@
+#include "sha256_prefix.h"
+
+#include "test.h"
+
+/*
+ * The prefix cache, under every single-buffer kernel. There are more
+ * prefixes with a whole block than the cache has entries, so the least
+ * recently used one gets dropped and has to be hashed again.
+ */
+
+#define ENTRIES	4
+
+/**
+ * prefix - hash a message through the cache and check it
+ * @c: cache
+ * @key: prefix key
+ * @plen: prefix length
+ * @hit: 1 if the prefix should come from the cache, 0 if it should be hashed
+ */
+
+static void prefix( struct sha256_prefix_cache *c, uint64_t key, size_t plen, int hit )
+{
+	struct sha256_ctx ctx;
+	uint8_t md[ 32 ], want[ 32 ];
+	int ret;
+
+	ret = sha256_prefix_init( c, &ctx, key, msg, plen );
+	sha256_update( &ctx, &msg[ plen ], 77 );
+	sha256_final( &ctx, md );
+
+	ref_sha256( msg, plen + 77, want );
+	check( "sha256_prefix_init", plen + 77, md, want, sizeof( want ) );
+	check_true( hit ? "sha256_prefix_init missed" : "sha256_prefix_init hit", ret == hit );
+}
+
+static void test_prefix( void )
+{
+	/* the first three have no whole block and are never cached */
+
+	static const size_t prefix_len[] = { 0, 10, 63, 64, 100, 128, 200, 1000 };
+	struct sha256_prefix_cache *c = sha256_prefix_cache_create( ENTRIES );
+
+	check_true( "sha256_prefix_cache_create", c != NULL );
+
+	if ( c == NULL )
+		return;
+
+	/* first time round everything is hashed, the last one drops key 3 */
+
+	for ( size_t p = 0; p < 8; p++ )
+		prefix( c, p, prefix_len[ p ], 0 );
+
+	/* the four most recent are still there */
+
+	for ( size_t p = 4; p < 8; p++ )
+		prefix( c, p, prefix_len[ p ], 1 );
+
+	/* key 3 comes back in place of the least recently used, key 4 */
+
+	prefix( c, 3, prefix_len[ 3 ], 0 );
+	prefix( c, 3, prefix_len[ 3 ], 1 );
+	prefix( c, 4, prefix_len[ 4 ], 0 );
+
+	for ( size_t p = 0; p < 3; p++ )
+		prefix( c, p, prefix_len[ p ], 0 );
+
+	sha256_prefix_cache_destroy( c );
+}
+
+int main( void )
+{
+	test_init();
+	run_kernels( test_prefix );
+
+	return test_done();
+}
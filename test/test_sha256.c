@@ -0,0 +1,130 @@
+#include "test.h"
+
+/*
+ * sha256 and the streaming interface, under every single-buffer kernel.
+ */
+
+/*
+ * Known answers, for the reference and the library alike.
+ */
+
+static void test_known( void )
+{
+	static const struct
+	{
+		const char *msg;
+		const char *md;
+	} kat[] = {
+		{ "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+		{ "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+		{ "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+		{ "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1" }
+	};
+	static const char *million_a = "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+	uint8_t md[ SHA256_DIGEST_SIZE ];
+	uint8_t a[ 1000 ];
+	struct sha256_ctx ctx;
+
+	for ( size_t i = 0; i < sizeof( kat ) / sizeof( kat[ 0 ] ); i++ )
+	{
+		size_t len = strlen( kat[ i ].msg );
+
+		ref_sha256( ( const uint8_t * ) kat[ i ].msg, len, md );
+		check_hex( "reference", len, md, kat[ i ].md );
+
+		sha256( ( const uint8_t * ) kat[ i ].msg, len, md );
+		check_hex( "sha256", len, md, kat[ i ].md );
+	}
+
+	memset( a, 'a', sizeof( a ) );
+	sha256_init( &ctx );
+
+	for ( int i = 0; i < 1000; i++ )
+		sha256_update( &ctx, a, sizeof( a ) );
+
+	sha256_final( &ctx, md );
+	check_hex( "sha256_update", 1000000, md, million_a );
+}
+
+static void test_oneshot( void )
+{
+	uint8_t md[ SHA256_DIGEST_SIZE ], want[ SHA256_DIGEST_SIZE ];
+
+	for ( size_t len = 0; len <= 300; len++ )
+	{
+		ref_sha256( msg, len, want );
+
+		sha256( msg, len, md );
+		check( "sha256", len, md, want, sizeof( md ) );
+
+		/* unaligned input */
+
+		for ( size_t off = 1; off < 4; off++ )
+		{
+			uint8_t *copy = malloc( len + off );
+
+			memcpy( &copy[ off ], msg, len );
+			sha256( &copy[ off ], len, md );
+			check( "sha256 unaligned", len, md, want, sizeof( md ) );
+			free( copy );
+		}
+	}
+
+	for ( size_t i = 0; i < EDGES; i++ )
+	{
+		ref_sha256( msg, edges[ i ], want );
+		sha256( msg, edges[ i ], md );
+		check( "sha256", edges[ i ], md, want, sizeof( md ) );
+	}
+}
+
+static void test_streaming( void )
+{
+	static const size_t splits[] = { 1, 3, 7, 13, 55, 56, 63, 64, 65, 119, 120, 200 };
+	uint8_t md[ SHA256_DIGEST_SIZE ], want[ SHA256_DIGEST_SIZE ];
+
+	for ( size_t i = 0; i < EDGES; i++ )
+	{
+		size_t len = edges[ i ];
+
+		ref_sha256( msg, len, want );
+
+		for ( size_t s = 0; s < sizeof( splits ) / sizeof( splits[ 0 ] ); s++ )
+		{
+			struct sha256_ctx ctx;
+			size_t off = 0, piece = splits[ s ];
+
+			/* pieces of changing odd lengths, so most start at an odd offset */
+
+			sha256_init( &ctx );
+
+			while ( off < len )
+			{
+				size_t n = piece < len - off ? piece : len - off;
+
+				sha256_update( &ctx, &msg[ off ], n );
+				off += n;
+				piece = piece * 3 % 127 + 1;
+			}
+
+			sha256_final( &ctx, md );
+			check( "sha256_update", len, md, want, sizeof( md ) );
+		}
+	}
+}
+
+static void test_sha256( void )
+{
+	test_known();
+	test_oneshot();
+	test_streaming();
+}
+
+int main( void )
+{
+	test_init();
+	test_known();
+	run_kernels( test_sha256 );
+
+	return test_done();
+}
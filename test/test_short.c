@@ -0,0 +1,38 @@
+#include "test.h"
+
+/*
+ * sha256_short, under every single-buffer kernel. Lengths past
+ * SHA256_SHORT_MAX go to sha256, a block's worth of them is checked too.
+ */
+
+static void test_short( void )
+{
+	uint8_t md[ SHA256_DIGEST_SIZE ], want[ SHA256_DIGEST_SIZE ];
+
+	for ( size_t len = 0; len <= SHA256_SHORT_MAX + 64; len++ )
+	{
+		ref_sha256( msg, len, want );
+
+		sha256_short( msg, len, md );
+		check( "sha256_short", len, md, want, sizeof( md ) );
+
+		/* unaligned input */
+
+		for ( size_t off = 1; off < 4; off++ )
+		{
+			uint8_t copy[ SHA256_SHORT_MAX + 64 + 4 ];
+
+			memcpy( &copy[ off ], msg, len );
+			sha256_short( &copy[ off ], len, md );
+			check( "sha256_short unaligned", len, md, want, sizeof( md ) );
+		}
+	}
+}
+
+int main( void )
+{
+	test_init();
+	run_kernels( test_short );
+
+	return test_done();
+}
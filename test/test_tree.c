@@ -0,0 +1,47 @@
+#include "sha256_tree.h"
+
+#include "test.h"
+
+/*
+ * sha256_tree against a tree built with the reference, under every
+ * single-buffer kernel.
+ */
+
+static void test_tree( void )
+{
+	uint8_t leaf[ 1 + 64 ], node[ 1 + 64 ], level[ 4 ][ 32 ], md[ 32 ];
+
+	/* 200 bytes in leaves of 64, four leaves, the last one short */
+
+	for ( size_t i = 0; i < 4; i++ )
+	{
+		size_t n = i < 3 ? 64 : 8;
+
+		leaf[ 0 ] = 0x00;
+		memcpy( &leaf[ 1 ], &msg[ i * 64 ], n );
+		ref_sha256( leaf, n + 1, level[ i ] );
+	}
+
+	for ( size_t i = 0; i < 2; i++ )
+	{
+		node[ 0 ] = 0x01;
+		memcpy( &node[ 1 ], level[ 2 * i ], 32 );
+		memcpy( &node[ 33 ], level[ 2 * i + 1 ], 32 );
+		ref_sha256( node, sizeof( node ), level[ i ] );
+	}
+
+	memcpy( &node[ 1 ], level[ 0 ], 32 );
+	memcpy( &node[ 33 ], level[ 1 ], 32 );
+	ref_sha256( node, sizeof( node ), level[ 0 ] );
+
+	sha256_tree( msg, 200, 64, NULL, md );
+	check( "sha256_tree", 200, md, level[ 0 ], sizeof( md ) );
+}
+
+int main( void )
+{
+	test_init();
+	run_kernels( test_tree );
+
+	return test_done();
+}